@@ -0,0 +1,165 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+/* This is a separate program to the game, it scores many bridge designs at once by running each one headless through
+   a scenario, spreading the jobs over several threads. Every thread has its own Bridge, and so its own physics world,
+   so the threads never share any simulation state.
+
+   Usage: batch <job list> [threads] [results file] [settle]
+
+   Each line of the job list is one job, a design file followed by optional scenario values:
+     design [steps] [boxes] [box interval] [box mass] [box x] [box y]
+   A design of "-" uses the built in test bridge. Blank lines and lines starting with # are ignored.
+   Designs can be text or binary files (see Bridge::Load()), binary ones load a good deal quicker.
+
+   The results are written as CSV, one line per job in the same order as the job list, to the results file or stdout.
+   Bridges are only left to sag into place before each run (see Bridge::SetPresettling()) when "settle" is given, each
+   thread settling every design it's handed itself, which shows up in the start_time column. */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include "evaluator.h"
+#include "work_queue.h"
+
+struct Job
+{
+	char       Design[256];
+	Scenario   Setup;
+	Evaluation Result;
+	bool       Loaded;
+};
+
+/* Reads the job list into a newly allocated array, returning the number of jobs, or -1 if the file couldn't be read. */
+static int loadJobs(const char *Filename, Job *&Jobs)
+{
+	FILE *file = fopen(Filename, "r");
+	if (file == NULL)
+		return -1;
+
+	int  count    = 0;
+	int  capacity = 64;
+	char line[512];
+
+	Jobs = new Job[capacity];
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		Job job;
+		if (sscanf(line, "%255s", job.Design) != 1 || job.Design[0] == '#')
+			continue;
+
+		sscanf(line, "%*s %d %d %d %f %f %f", &job.Setup.Steps, &job.Setup.BoxCount, &job.Setup.BoxInterval,
+			&job.Setup.BoxMass, &job.Setup.BoxX, &job.Setup.BoxY);
+		job.Loaded = false;
+		memset(&job.Result, 0, sizeof(job.Result));
+		job.Result.CollapseStep = -1;
+
+		if (count == capacity)
+		{
+			Job *grown = new Job[capacity * 2];
+			for (int index = 0; index < count; index++)
+				grown[index] = Jobs[index];
+			delete [] Jobs;
+			Jobs      = grown;
+			capacity *= 2;
+		}
+		Jobs[count++] = job;
+	}
+
+	fclose(file);
+	return count;
+}
+
+/* Each worker thread runs this, evaluating jobs until the queue runs dry. */
+static void worker(int Worker, WorkQueue *Queue, Job *Jobs, bool Settle)
+{
+	Bridge bridge;
+	int    index;
+
+	bridge.SetPresettling(Settle);
+
+	while (Queue->Pop(Worker, index))
+	{
+		Job &job = Jobs[index];
+		if (strcmp(job.Design, "-") == 0)
+		{
+			bridge.CreateTestBridge();
+			job.Loaded = true;
+		}
+		else
+		{
+			job.Loaded = bridge.Load(job.Design);
+		}
+
+		if (job.Loaded)
+			Evaluator::Run(bridge, job.Setup, job.Result);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s <job list> [threads] [results file] [settle]\n", argv[0]);
+		return -1;
+	}
+
+	Job *jobs     = NULL;
+	int  jobCount = loadJobs(argv[1], jobs);
+	if (jobCount < 0)
+	{
+		printf("Could not read job list '%s', aborting...\n", argv[1]);
+		return -1;
+	}
+
+	int threads = argc > 2 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+	if (threads < 1)
+		threads = 1;
+	if (threads > jobCount && jobCount > 0)
+		threads = jobCount;
+
+	Timer        timer;
+	bool         settle  = argc > 4 && strcmp(argv[4], "settle") == 0;
+	WorkQueue    queue(jobCount, threads);
+	std::thread *workers = new std::thread[threads];
+	for (int index = 0; index < threads; index++)
+		workers[index] = std::thread(worker, index, &queue, jobs, settle);
+	for (int index = 0; index < threads; index++)
+		workers[index].join();
+	delete [] workers;
+	double wallTime = timer.Seconds();
+
+	FILE *output = argc > 3 ? fopen(argv[3], "w") : stdout;
+	if (output == NULL)
+	{
+		printf("Could not open results file '%s', aborting...\n", argv[3]);
+		delete [] jobs;
+		return -1;
+	}
+
+	fprintf(output, "design,steps,boxes,box_interval,box_mass,box_x,box_y,outcome,simulated_steps,broken_joints,max_sag,wall_time,collapse_step,start_time\n");
+	for (int index = 0; index < jobCount; index++)
+	{
+		Job &job = jobs[index];
+		fprintf(output, "%s,%d,%d,%d,%g,%g,%g,%s,%d,%d,%.4f,%.6f,%d,%.6f\n", job.Design,
+			job.Setup.Steps, job.Setup.BoxCount, job.Setup.BoxInterval, job.Setup.BoxMass, job.Setup.BoxX, job.Setup.BoxY,
+			!job.Loaded ? "error" : (job.Result.Collapsed ? "collapsed" : "held"),
+			job.Result.Steps, job.Result.BrokenJoints, job.Result.MaxSag, job.Result.WallTime, job.Result.CollapseStep, job.Result.StartTime);
+	}
+
+	if (output != stdout)
+		fclose(output);
+
+	fprintf(stderr, "%d jobs on %d threads in %.3fs\n", jobCount, threads, wallTime);
+	delete [] jobs;
+	return 0;
+}
@@ -12,9 +12,18 @@ Permission is granted to anyone to use this software for any purpose, including
 #ifndef __BRIDGE_H_
 #define __BRIDGE_H_
 
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include "bridge_file.h"
+#include "bridge_snapshot.h"
 #include "renderer.h"
-#include "physics.h"
+#include "physics_box2d.h"
+#include "physics_truss.h"
 #include "pin.h"
+#include "pin_grid.h"
+#include "pool.h"
+#include "settle_cache.h"
 #include "slab_structure.h"
 #include "slab_support.h"
 
@@ -25,6 +34,11 @@ Permission is granted to anyone to use this software for any purpose, including
    This will be removed and replaced with the instances of cars in the level. */
 #define BREAK_AT_FORCE  2.5f
 #define MAX_BLOCKS      100 /* temporary */
+#define PIN_ACCURACY    0.5f /* How close a touch has to be to a pin to count as touching it. */
+#define ROAD_STRAIGHTNESS 0.999f /* How straight two road slabs must be to be welded together, as the cosine of the bend. */
+#define DEBRIS_MARGIN   100.0f /* How far past the ends of the bridge, or below it, things can go before being thrown away. */
+#define SETTLE_STEP     (1.0f / 60.0f) /* The step size used to let a bridge come to rest, see settle(). */
+#define SETTLE_REST     0.05f /* How slowly (in m/s) everything has to be moving for the bridge to count as at rest. */
 
 typedef enum Bridge_EditMode
 {
@@ -34,6 +48,13 @@ typedef enum Bridge_EditMode
 }
 Bridge_EditMode;
 
+typedef enum Bridge_Engine
+{
+	Bridge_Engine_Box2D = 0, /* See physics_box2d.h. */
+	Bridge_Engine_Truss,     /* See physics_truss.h. */
+}
+Bridge_Engine;
+
 /* This class mostly holds editing/meta data for bridge creation.
    For now it is very simple, holding only a list of pins and slabs that make up the bridge.
    This class is/will be used for adding/removing/moving items around in the bridge, handling input, and finally
@@ -41,109 +62,840 @@ Bridge_EditMode;
 class Bridge
 {
 protected:
-	/* A list of slabs that make up the bridge. */
-	struct Slabs
-	{
-		Slab *First; /* The root element, contains a pointer to the ->Next instance. */
-		Slab *Last;  /* NULL on start, set to the most recently added slab. Make it easier to add to the end of the list. */
-	}
-	slabs;
-
-	/* A list of pins/joins that make up the bridge. */
-	struct Pins
-	{
-		Pin *First;
-		Pin *Last;
-	}
-	pins;
+	/* The slabs and pins/joins that make up the bridge, stored back to back in memory in the order they were added.
+	   Slabs point at their pins, which is fine as pool items never move, apart from when one is removed, see removePin().
+	   Each pin also has a list of the slabs attached to it, threaded through the slabs by index (see attach()). */
+	Pool<Slab>       slabs;
+	Pool<Pin>        pins;
+	PinGrid          pinGrid; /* Finds pins by their edit-time position without walking the whole list. */
+	TransformStore   transforms; /* The positions and angles of all the pins and slabs, see Positioning. */
 
-	Physics          physics; /* The abstracted physics engine, be it Box2D, Chipmunk, etc. */
+	Physics         *physics; /* The abstracted physics engine, be it Box2D, Chipmunk, etc. */
+	Bridge_Engine    engine;
+	ThreadPool      *threadPool;
+	float            stepBudget;
 	Pin             *startPin;
 	Bridge_EditMode  editMode;
 	bool             running;
+	int              brokenJoints; /* How many joints have snapped since the simulation was started. */
 	
-	/* The following is temporary stuff to test the bridge with for now, will be replaced by cars. */
-	void            *boxes[MAX_BLOCKS];
-	int              boxCount;
+	/* A pin that only has structure slabs attached to it doesn't get a body of its own while simulating (see
+	   createSimulation()), instead following the end of one of its slabs around. Likewise slabs welded into a road
+	   (see findRoads()) follow the first slab of the road. */
+	struct Follower
+	{
+		int    Target;  /* The transform index of what follows... */
+		int    Source;  /* ... and of what it follows. */
+		float  OffsetX; /* Where the target is, and how it's rotated, as seen from the source. */
+		float  OffsetY;
+		float  Cosine;
+		float  Sine;
+	};
+
+	/* The welding of slabs into roads, see findRoads(). */
+	struct Road
+	{
+		int    First;   /* Where the road's slabs start in roadSlabs, in order along the road. */
+		int    Count;
+		void  *Body;    /* NULL if the road wasn't welded after all. */
+	};
+
+	struct Link
+	{
+		int    Left;    /* The slab the road carries on into at each end of a slab, or -1. */
+		int    Right;
+		int    Road;    /* The road the slab is part of, or -1. */
+	};
+
+	Follower        *followers;
+	int              followerCount;
+	int              followerCapacity;
+	Pool<Road>       roads;
+	Pool<int>        roadSlabs;
+	int             *anchors;       /* Scratch space for createSimulation(), one per transform index. */
+	int             *partners;
+	int              anchorCapacity;
+	Link            *links;         /* More scratch space, one per slab. */
+	int              linkCapacity;
+	bool             collapsePins;
+	bool             mergeRoads;
+	bool            *debris;        /* One per transform index, for cullDebris(). */
+	int              debrisCapacity;
+
+	/* The connectivity index, one entry per transform index (see updateConnectivity()): which piece of the running
+	   bridge each pin and slab is part of, whether that piece is still held up by a fixed pin, and whether it has
+	   come loose, which is simply the two put together, for handing to the physics engine. */
+	int             *pieces;
+	bool            *grounded;
+	bool            *loose;
+	int              pieceCapacity;
+	bool             connected;     /* Whether the index is up to date. */
+	bool             collapsed;     /* Whether anything has come loose since the simulation was created, see IsStanding(). */
+	int              debrisCountdown; /* Steps until the next cullDebris(). */
+	SettleCache      settled;       /* The state recent designs came to rest in, see settle(). */
+	bool             presettle;
+
+	enum
+	{
+		Anchor_None = -1, /* Nothing is attached to the pin (yet). */
+		Anchor_Body = -2, /* The pin needs a body of its own. */
+
+		Road_MaxSlabs = 32, /* Roads longer than this are welded in several pieces. */
+
+		Debris_Interval = 30, /* How many steps go by between looking for debris. */
+
+		Settle_MaxSteps = 600, /* Give up waiting for a bridge to come to rest after this many SETTLE_STEPs... */
+		Settle_Interval = 30,  /* ... or once it has been still for this many in a row. */
+	};
+
+	/* The following is temporary stuff to test the bridge with for now, will be replaced by cars.
+	   The debug boxes only exist while simulating, so they get a store of their own that is emptied on Stop(). */
+	TransformStore   boxes;
+
+	BridgeSnapshot   drawn;   /* What Draw() draws from. */
 
 protected:
 	/* This returns a Pin instance at the specified co-ordinates with the specified accuracy, or NULL if none are found.
-	   Accuracy caters for touches on screens, where the finger normally touches "more or less" around an area. */
+	   Accuracy caters for touches on screens, where the finger normally touches "more or less" around an area.
+	   While editing, pins are where they were built, so the grid can answer this. Once the simulation is running they
+	   move around, so we fall back to checking each pin's current position. */
 	Pin* getPinAt(float X, float Y, float Accuracy)
 	{
-		Pin *result = pins.First;
-		while (result)
+		if (!running)
+			return pinGrid.Find(X, Y, Accuracy);
+
+		for (int index = 0; index < pins.Count(); index++)
 		{
-			if ( (fabs(result->Transform.X() - X) <= Accuracy) && (fabs(result->Transform.Y() - Y) <= Accuracy) )
-				break;
-			result = result->Next;
+			Pin *pin = pins[index];
+			if ( (fabs(pin->Transform.X() - X) <= Accuracy) && (fabs(pin->Transform.Y() - Y) <= Accuracy) )
+				return pin;
 		}
-		return result;
+		return NULL;
 	}
 
 	/* This first tries to find a Pin at the current location, returning it if one was found, otherwise it tries to add one. */
 	Pin* addPin(float X, float Y)
 	{
-		Pin *pin = getPinAt(X, Y, 0.5f);
+		Pin *pin = getPinAt(X, Y, PIN_ACCURACY);
 		if (pin != NULL)
 			return pin;
 
-		pin = new Pin(X, Y, false);
-		if (pin == NULL)
-			return pin;
-
-		if (pins.First == NULL)
-		{
-			pins.First = pin;
-			pins.Last  = pin;
-		}
-		else
-		{
-			pins.Last->Next = pin;
-			pins.Last       = pin;
-		}
+		pin = new (pins.Allocate()) Pin(&transforms, X, Y, false);
+		pinGrid.Add(pin);
+		if (running)
+			simulatePin(pin);
 
 		return pin;
 	}
 
+	/* Returns where the index of the slab after Target in Joint's list of slabs is kept. */
+	int& nextAt(Slab *Target, Pin *Joint)
+	{
+		return Target->Left == Joint ? Target->NextLeft : Target->NextRight;
+	}
+
+	/* Adds slab Index to the front of the lists of slabs attached to its pins. */
+	void attach(int Index)
+	{
+		Slab *slab = slabs[Index];
+		slab->NextLeft         = slab->Left->FirstSlab;
+		slab->Left->FirstSlab  = Index;
+		slab->NextRight        = slab->Right->FirstSlab;
+		slab->Right->FirstSlab = Index;
+	}
+
+	/* Finds slab From in Joint's list of slabs and puts To in its place, To being either the slab after From (taking
+	   From out of the list), or the index From has been moved to. */
+	void relink(Pin *Joint, int From, int To)
+	{
+		int *link = &Joint->FirstSlab;
+		while (*link != From)
+			link = &nextAt(slabs[*link], Joint);
+		*link = To;
+	}
+
 	/* This adds two Pins, one at X1,Y1 and another at X2,Y2.
-	   These Pins serve to hold up the newly created Slab instance this function will create. */
+	   These Pins serve to hold up the newly created Slab instance this function will create, so they can't be the same
+	   pin, a slab with no length being of no use to anyone (and something Box2D won't have). */
 	Slab* addSlab(float X1, float Y1, float X2, float Y2, Slab_Purpose Purpose)
 	{
 		Pin  *left  = addPin(X1, Y1);
 		Pin  *right = addPin(X2, Y2);
 		Slab *slab  = NULL;
 
-		if (left == NULL || right == NULL)
+		if (left == NULL || right == NULL || left == right)
 			return slab;
 		
+		/* The derived slab types only set the Purpose, so they fit in a Slab sized pool entry. */
+		static_assert(sizeof(SlabSupport) == sizeof(Slab) && sizeof(SlabStructure) == sizeof(Slab), "Slab types must not add members");
 		switch (Purpose)
 		{
 			case Slab_Purpose_Support: 
-				slab = new SlabSupport(left, right);
+				slab = new (slabs.Allocate()) SlabSupport(&transforms, left, right);
 				break;
 			case Slab_Purpose_Structure:
-				slab = new SlabStructure(left, right); 
+				slab = new (slabs.Allocate()) SlabStructure(&transforms, left, right); 
 				break;
 			default:
 				break;
 		}
-
 		if (slab == NULL)
 			return slab;
 
-		if (slabs.First == NULL)
+		attach(slabs.Count() - 1);
+		if (running)
+			simulateSlab(slab);
+
+		return slab;
+	}
+
+	/* Returns the index of a slab passing within Accuracy of X,Y, or -1 if there isn't one. Supports that have
+	   snapped during the simulation don't count, they aren't there any more. */
+	int getSlabAt(float X, float Y, float Accuracy)
+	{
+		for (int index = 0; index < slabs.Count(); index++)
+		{
+			Slab *slab = slabs[index];
+			if (running && slab->PhysicBody == NULL)
+				continue;
+
+			float x0     = slab->Left->Transform.X(),  y0 = slab->Left->Transform.Y();
+			float deltaX = slab->Right->Transform.X() - x0;
+			float deltaY = slab->Right->Transform.Y() - y0;
+			float span   = deltaX * deltaX + deltaY * deltaY;
+			float along  = span > 0.0f ? ((X - x0) * deltaX + (Y - y0) * deltaY) / span : 0.0f;
+			along        = along < 0.0f ? 0.0f : (along > 1.0f ? 1.0f : along);
+			float awayX  = X - (x0 + deltaX * along);
+			float awayY  = Y - (y0 + deltaY * along);
+			if (awayX * awayX + awayY * awayY <= Accuracy * Accuracy)
+				return index;
+		}
+		return -1;
+	}
+
+	/* Takes a slab out of the bridge, and out of the simulation if it's running. Leaving is a pin that is about to be
+	   removed as well, so doesn't need keeping together. */
+	void removeSlab(int Index, Pin *Leaving = NULL)
+	{
+		Slab *slab = slabs[Index];
+		if (running && slab->PhysicBody != NULL)
+		{
+			splitRoads();
+			/* Other slabs may be hinged straight to this one, so their pins need a body to hold them together. */
+			if (slab->Left != Leaving)
+				bodyOf(slab->Left);
+			if (slab->Right != Leaving)
+				bodyOf(slab->Right);
+
+			if (slab->Purpose == Slab_Purpose_Structure)
+				physics->RemoveBody(slab->PhysicBody);
+			else
+				physics->RemoveJoint(slab->PhysicBody);
+			connected = false;
+		}
+		/* Pins can still be following it even without a body, after it was culled, and its transform is about to be
+		   handed on to whatever is added next. */
+		if (running)
+			unfollowAll(slab->Transform.Index());
+		relink(slab->Left, Index, slab->NextLeft);
+		relink(slab->Right, Index, slab->NextRight);
+		transforms.Release(slab->Transform.Index());
+
+		/* The last slab gets moved into the gap, so its pins' lists have to follow it. */
+		int last = slabs.Count() - 1;
+		slabs.Remove(Index);
+		if (last != Index)
+		{
+			Slab *moved = slabs[Index];
+			relink(moved->Left, last, Index);
+			relink(moved->Right, last, Index);
+		}
+	}
+
+	/* Takes a pin out of the bridge, along with every slab attached to it. */
+	void removePin(Pin *Target)
+	{
+		while (Target->FirstSlab >= 0)
+			removeSlab(Target->FirstSlab, Target);
+
+		if (running && Target->PhysicBody != NULL)
+		{
+			physics->RemoveBody(Target->PhysicBody);
+			connected = false;
+		}
+		else if (running)
+			unfollow(Target->Transform.Index());
+		transforms.Release(Target->Transform.Index());
+		pinGrid.Remove(Target);
+		if (startPin == Target)
+			startPin = NULL;
+
+		int index = 0;
+		while (pins[index] != Target)
+			index++;
+
+		/* The last pin gets moved into the gap, so everything that points at it has to follow it. */
+		Pin *last = pins.Last();
+		if (last != Target)
+			pinGrid.Remove(last);
+		pins.Remove(index);
+		if (last != Target)
+		{
+			pinGrid.Add(Target);
+			for (int index = Target->FirstSlab; index >= 0; )
+			{
+				Slab *slab = slabs[index];
+				index = nextAt(slab, last);
+				if (slab->Left == last)
+					slab->Left = Target;
+				if (slab->Right == last)
+					slab->Right = Target;
+			}
+			if (startPin == last)
+				startPin = Target;
+		}
+	}
+
+	/* Gives a pin a body in the physics world. */
+	void simulatePin(Pin *Target)
+	{
+		Target->PhysicBody = physics->AddPin(Target->Transform.X(), Target->Transform.Y(), Target->Fixed);
+		Target->Transform.SetBody(Target->PhysicBody);
+		connected = false;
+	}
+
+	/* Stops the transform at index Target following anything around, returning the index of what it followed, or -1
+	   if it wasn't following anything. */
+	int unfollow(int Target)
+	{
+		for (int index = 0; index < followerCount; index++)
+		{
+			if (followers[index].Target == Target)
+			{
+				int source = followers[index].Source;
+				followers[index] = followers[--followerCount];
+				return source;
+			}
+		}
+		return -1;
+	}
+
+	/* Stops everything following the transform at index Source around, leaving it wherever it was last. */
+	void unfollowAll(int Source)
+	{
+		for (int index = followerCount - 1; index >= 0; index--)
+		{
+			if (followers[index].Source == Source)
+				followers[index] = followers[--followerCount];
+		}
+	}
+
+	/* Returns the body of a pin in the running simulation. A pin that was left without one follows the slab it's
+	   anchored to, with the rest of its slabs hinged straight to that one. It's given a body now, pinned to its anchor
+	   slab, and the hinges that are still there are moved over to it. Slabs whose hinge has snapped stay loose. */
+	void* bodyOf(Pin *Target)
+	{
+		if (Target->PhysicBody != NULL)
+			return Target->PhysicBody;
+
+		splitRoads(); /* Roads are welded straight through the pins inside them, so they can't take another body. */
+		int   source = unfollow(Target->Transform.Index());
+		Slab *anchor = NULL;
+		for (int index = Target->FirstSlab; index >= 0; index = nextAt(slabs[index], Target))
+		{
+			if (slabs[index]->Transform.Index() == source)
+				anchor = slabs[index];
+		}
+
+		simulatePin(Target);
+		float x = Target->Transform.X();
+		float y = Target->Transform.Y();
+		if (anchor == NULL || anchor->PhysicBody == NULL)
+			return Target->PhysicBody; /* Nothing left to hold on to, it was culled along with its hinges. */
+
+		physics->Join(Target->PhysicBody, anchor->PhysicBody, x, y);
+		for (int index = Target->FirstSlab; index >= 0; index = nextAt(slabs[index], Target))
+		{
+			Slab *slab = slabs[index];
+			if (slab == anchor || slab->Purpose != Slab_Purpose_Structure || slab->PhysicBody == NULL)
+				continue;
+
+			void *hinge = physics->FindJoint(anchor->PhysicBody, slab->PhysicBody, x, y);
+			if (hinge == NULL)
+				continue;
+			physics->RemoveJoint(hinge);
+			physics->Join(Target->PhysicBody, slab->PhysicBody, x, y);
+		}
+		return Target->PhysicBody;
+	}
+
+	/* Gives a slab a body (or a joint, for supports) in the physics world, attached to the bodies of its pins. */
+	void simulateSlab(Slab *Target)
+	{
+		void *left  = bodyOf(Target->Left);
+		void *right = bodyOf(Target->Right);
+		switch (Target->Purpose)
+		{
+			case Slab_Purpose_Structure:
+				Target->PhysicBody = physics->AddStructure(left, right);
+				Target->Transform.SetBody(Target->PhysicBody);
+				break;
+			case Slab_Purpose_Support:
+				Target->PhysicBody = physics->AddSupport(left, right);
+				break;
+			default:
+				break;
+		}
+		connected = false;
+	}
+
+	/* Makes the transform at index Target follow the one at index Source around, staying where it was relative to it
+	   at edit time. */
+	void addFollower(int Target, int Source)
+	{
+		if (followerCount == followerCapacity)
+		{
+			int       capacity = followerCapacity > 0 ? followerCapacity * 2 : 256;
+			Follower *grown    = new Follower[capacity];
+			if (followerCount > 0)
+				memcpy(grown, followers, sizeof(Follower) * followerCount);
+			delete [] followers;
+			followers        = grown;
+			followerCapacity = capacity;
+		}
+
+		/* Turn the offset and rotation around into Source's point of view. */
+		TransformStore::Set &original = transforms.Get(TransformStore::Original);
+		float     deltaX   = original.X[Target] - original.X[Source];
+		float     deltaY   = original.Y[Target] - original.Y[Source];
+		float     cosine   = original.Cosine[Source];
+		float     sine     = original.Sine[Source];
+		Follower &follower = followers[followerCount++];
+		follower.Target    = Target;
+		follower.Source    = Source;
+		follower.OffsetX   = deltaX * cosine + deltaY * sine;
+		follower.OffsetY   = deltaY * cosine - deltaX * sine;
+		follower.Cosine    = original.Cosine[Target] * cosine + original.Sine[Target] * sine;
+		follower.Sine      = original.Sine[Target] * cosine - original.Cosine[Target] * sine;
+	}
+
+	/* Puts everything that has no body of its own where it belongs on whatever it follows. */
+	void follow()
+	{
+		TransformStore::Set &current = transforms.Get(TransformStore::Current);
+		for (int index = 0; index < followerCount; index++)
+		{
+			const Follower &follower = followers[index];
+			float           cosine   = current.Cosine[follower.Source];
+			float           sine     = current.Sine[follower.Source];
+			current.X[follower.Target]      = current.X[follower.Source] + cosine * follower.OffsetX - sine * follower.OffsetY;
+			current.Y[follower.Target]      = current.Y[follower.Source] + sine * follower.OffsetX + cosine * follower.OffsetY;
+			current.Cosine[follower.Target] = cosine * follower.Cosine - sine * follower.Sine;
+			current.Sine[follower.Target]   = sine * follower.Cosine + cosine * follower.Sine;
+		}
+	}
+
+	/* Makes sure the scratch arrays used while creating the simulation are big enough. */
+	void reserveScratch()
+	{
+		if (anchorCapacity < transforms.Count())
+		{
+			delete [] anchors;
+			delete [] partners;
+			anchorCapacity = transforms.Count() * 2;
+			anchors        = new int[anchorCapacity];
+			partners       = new int[anchorCapacity];
+		}
+		if (linkCapacity < slabs.Count())
+		{
+			delete [] links;
+			linkCapacity = slabs.Count() * 2;
+			links        = new Link[linkCapacity];
+		}
+	}
+
+	/* Returns the slab whose transform follows the body of slab Index, which is the slab itself unless it's been
+	   welded into a road, in which case it's the first slab of that road. */
+	Slab* rootOf(int Index)
+	{
+		Road *road = links[Index].Road >= 0 ? roads[links[Index].Road] : NULL;
+		return road != NULL && road->Body != NULL ? slabs[*roadSlabs[road->First]] : slabs[Index];
+	}
+
+	/* Whether the two slabs meeting at Joint carry on in (nearly) a straight line. */
+	bool straight(Pin *Joint, Slab *First, Slab *Second)
+	{
+		Pin   *first   = First->Left  == Joint ? First->Right  : First->Left;
+		Pin   *second  = Second->Left == Joint ? Second->Right : Second->Left;
+		float  firstX  = first->Transform.X()  - Joint->Transform.X(), firstY  = first->Transform.Y()  - Joint->Transform.Y();
+		float  secondX = second->Transform.X() - Joint->Transform.X(), secondY = second->Transform.Y() - Joint->Transform.Y();
+		return firstX * secondX + firstY * secondY <= -ROAD_STRAIGHTNESS * First->Length * Second->Length;
+	}
+
+	/* Welds runs of nearly straight road into single bodies, so that a car has one body to roll along instead of one
+	   per slab. Two structure slabs carry on from each other if they're the only two slabs at a pin without a body of
+	   its own (see createSimulation()), and they bend by less than ROAD_STRAIGHTNESS there. Each run is walked from
+	   one end to the other and cut up into roads of no more than Road_MaxSlabs slabs, which are hinged to each other
+	   like any other slabs. */
+	void findRoads()
+	{
+		for (int index = 0; index < pins.Count(); index++)
+		{
+			Pin *pin    = pins[index];
+			int  first  = anchors[pin->Transform.Index()];
+			int  second = partners[pin->Transform.Index()];
+			if (pin->PhysicBody != NULL || first < 0 || second < 0 || !straight(pin, slabs[first], slabs[second]))
+				continue;
+
+			(slabs[first]->Left  == pin ? links[first].Left  : links[first].Right)  = second;
+			(slabs[second]->Left == pin ? links[second].Left : links[second].Right) = first;
+		}
+
+		/* Every run has two ends, where one side carries on and the other doesn't. */
+		for (int index = 0; index < slabs.Count(); index++)
+		{
+			if (links[index].Road >= 0 || (links[index].Left < 0) == (links[index].Right < 0))
+				continue;
+
+			Road *road     = NULL;
+			int   previous = -1;
+			int   current  = index;
+			while (current >= 0)
+			{
+				if (road == NULL || road->Count == Road_MaxSlabs)
+				{
+					road        = new (roads.Allocate()) Road;
+					road->First = roadSlabs.Count();
+					road->Count = 0;
+					road->Body  = NULL;
+				}
+				*(int*)roadSlabs.Allocate() = current;
+				road->Count++;
+				links[current].Road = roads.Count() - 1;
+
+				int next = links[current].Left;
+				if (next == previous)
+					next = links[current].Right;
+				previous = current;
+				current  = next;
+			}
+		}
+
+		/* Now weld each road together. A road of one slab is just a slab. */
+		for (int index = 0; index < roads.Count(); index++)
+		{
+			Road *road = roads[index];
+			if (road->Count < 2)
+				continue;
+
+			float x1[Road_MaxSlabs], y1[Road_MaxSlabs], x2[Road_MaxSlabs], y2[Road_MaxSlabs];
+			for (int slab = 0; slab < road->Count; slab++)
+			{
+				Slab *member = slabs[*roadSlabs[road->First + slab]];
+				x1[slab] = member->Left->Transform.X();
+				y1[slab] = member->Left->Transform.Y();
+				x2[slab] = member->Right->Transform.X();
+				y2[slab] = member->Right->Transform.Y();
+			}
+
+			road->Body = physics->AddSlabs(x1, y1, x2, y2, road->Count);
+			if (road->Body == NULL)
+				return; /* This physics engine doesn't weld slabs, so they're all added separately after all. */
+
+			/* The body follows the first slab, and the rest of the slabs follow that. */
+			Slab *root = slabs[*roadSlabs[road->First]];
+			for (int slab = 0; slab < road->Count; slab++)
+			{
+				Slab *member = slabs[*roadSlabs[road->First + slab]];
+				member->PhysicBody = road->Body;
+				if (member == root)
+					member->Transform.SetBody(road->Body);
+				else
+					addFollower(member->Transform.Index(), root->Transform.Index());
+			}
+		}
+	}
+
+	/* Breaks the roads welded by findRoads() back up into separate slabs, hinged together at their pins again, and
+	   has the pins without bodies follow their own slabs once more. This is done as soon as anything in the bridge
+	   breaks, as a bridge that is giving way is exactly when the road needs to bend, and before editing a running
+	   simulation. */
+	void splitRoads()
+	{
+		if (roads.Count() == 0)
+			return;
+
+		for (int index = 0; index < roads.Count(); index++)
+		{
+			Road *road = roads[index];
+			if (road->Body == NULL)
+				continue;
+
+			float  x1[Road_MaxSlabs], y1[Road_MaxSlabs], x2[Road_MaxSlabs], y2[Road_MaxSlabs];
+			void  *pieces[Road_MaxSlabs];
+			for (int slab = 0; slab < road->Count; slab++)
+			{
+				Slab *member = slabs[*roadSlabs[road->First + slab]];
+				x1[slab] = member->Left->Transform.X();
+				y1[slab] = member->Left->Transform.Y();
+				x2[slab] = member->Right->Transform.X();
+				y2[slab] = member->Right->Transform.Y();
+			}
+
+			physics->Split(road->Body, x1, y1, x2, y2, road->Count, pieces);
+			for (int slab = 0; slab < road->Count; slab++)
+			{
+				Slab *member = slabs[*roadSlabs[road->First + slab]];
+				member->PhysicBody = pieces[slab];
+				member->Transform.SetBody(pieces[slab]);
+				if (slab == 0)
+					continue;
+
+				Slab *previous = slabs[*roadSlabs[road->First + slab - 1]];
+				Pin  *shared   = (member->Left == previous->Left || member->Left == previous->Right) ? member->Left : member->Right;
+				physics->Join(pieces[slab - 1], pieces[slab], shared->Transform.X(), shared->Transform.Y());
+			}
+		}
+		roads.Clear();
+		roadSlabs.Clear();
+
+		followerCount = 0;
+		for (int index = 0; index < pins.Count(); index++)
+		{
+			Pin *pin = pins[index];
+			if (pin->PhysicBody == NULL)
+				addFollower(pin->Transform.Index(), slabs[anchors[pin->Transform.Index()]]->Transform.Index());
+		}
+		connected = false;
+	}
+
+	/* Brings the connectivity index up to date. The physics engine knows which joints are still there, so it sorts
+	   everything with a body of its own into pieces (see Physics::GetGroups()), and everything without one shares the
+	   piece of whatever it follows. This is redone as soon as a joint snaps, that being the only way pieces come
+	   apart by themselves, and after edits or culling the next time it's needed. */
+	void updateConnectivity()
+	{
+		int count = transforms.Count();
+		if (pieceCapacity < count)
+		{
+			delete [] pieces;
+			delete [] grounded;
+			delete [] loose;
+			pieceCapacity = count * 2;
+			pieces        = new int[pieceCapacity];
+			grounded      = new bool[pieceCapacity];
+			loose         = new bool[pieceCapacity];
+		}
+
+		physics->GetGroups(transforms.Bodies(), count, pieces, grounded);
+		for (int index = 0; index < followerCount; index++)
+		{
+			pieces[followers[index].Target]   = pieces[followers[index].Source];
+			grounded[followers[index].Target] = grounded[followers[index].Source];
+		}
+		for (int index = 0; index < count; index++)
+		{
+			loose[index] = pieces[index] >= 0 && !grounded[index];
+			collapsed    = collapsed || loose[index];
+		}
+		connected = true;
+	}
+
+	/* Returns the piece of the running bridge that a pin is part of, or -1 if it isn't in the simulation. */
+	int pieceOf(Pin *Target)
+	{
+		if (!connected)
+			updateConnectivity();
+		return pieces[Target->Transform.Index()];
+	}
+
+	/* Returns the piece of the running bridge that slab Index is part of, or -1 if it isn't in the simulation, which
+	   includes supports that have snapped. */
+	int pieceOf(int Index)
+	{
+		Slab *slab = slabs[Index];
+		if (slab->Purpose == Slab_Purpose_Support)
+			return slab->PhysicBody != NULL ? pieceOf(slab->Left) : -1;
+
+		if (!connected)
+			updateConnectivity();
+		return pieces[slab->Transform.Index()];
+	}
+
+	/* Whether a pin is part of a piece that is still held up by a fixed pin. */
+	bool isGrounded(Pin *Target)
+	{
+		return pieceOf(Target) >= 0 && grounded[Target->Transform.Index()];
+	}
+
+	/* Whether slab Index is part of a piece that is still held up by a fixed pin. */
+	bool isGrounded(int Index)
+	{
+		Slab *slab = slabs[Index];
+		return pieceOf(Index) >= 0 && (slab->Purpose == Slab_Purpose_Support ? isGrounded(slab->Left) : grounded[slab->Transform.Index()]);
+	}
+
+	/* Takes whatever has fallen out of the world, or come loose from every fixed pin (going by the connectivity index)
+	   and settled, out of the simulation (see Physics::FindDebris()). It stays drawn wherever it was last, but costs nothing to step or copy out any more.
+	   Supports go along with either of their pins. */
+	void cullDebris()
+	{
+		/* The world ends DEBRIS_MARGIN past the ends of the bridge as it was built, and as far below its lowest pin. */
+		float left = FLT_MAX, right = -FLT_MAX, bottom = FLT_MAX;
+		for (int index = 0; index < pins.Count(); index++)
 		{
-			slabs.First = slab;
-			slabs.Last  = slab;
+			Pin *pin = pins[index];
+			left   = pin->Transform.OriginalX() < left   ? pin->Transform.OriginalX() : left;
+			right  = pin->Transform.OriginalX() > right  ? pin->Transform.OriginalX() : right;
+			bottom = pin->Transform.OriginalY() < bottom ? pin->Transform.OriginalY() : bottom;
+		}
+		left   -= DEBRIS_MARGIN;
+		right  += DEBRIS_MARGIN;
+		bottom -= DEBRIS_MARGIN;
+
+		bool boxDebris[MAX_BLOCKS];
+		if (physics->FindDebris(boxes.Bodies(), boxes.Count(), left, right, bottom, NULL, boxDebris) > 0)
+		{
+			for (int index = 0; index < boxes.Count(); index++)
+			{
+				if (!boxDebris[index])
+					continue;
+				physics->RemoveBody(boxes.Bodies()[index]);
+				boxes.Bodies()[index] = NULL;
+			}
+		}
+
+		if (debrisCapacity < transforms.Count())
+		{
+			delete [] debris;
+			debrisCapacity = transforms.Count() * 2;
+			debris         = new bool[debrisCapacity];
+		}
+
+		if (!connected)
+			updateConnectivity();
+		int found = physics->FindDebris(transforms.Bodies(), transforms.Count(), left, right, bottom, loose, debris);
+		if (found > 0 && roads.Count() > 0)
+		{
+			/* There's no taking only part of a welded road away. */
+			splitRoads();
+			updateConnectivity();
+			found = physics->FindDebris(transforms.Bodies(), transforms.Count(), left, right, bottom, loose, debris);
+		}
+		if (found == 0)
+			return;
+		connected = false;
+
+		/* Supports first, while their pins are still there to ask about. */
+		for (int index = 0; index < slabs.Count(); index++)
+		{
+			Slab *slab = slabs[index];
+			if (slab->Purpose != Slab_Purpose_Support || slab->PhysicBody == NULL)
+				continue;
+			if (debris[slab->Left->Transform.Index()] || debris[slab->Right->Transform.Index()])
+			{
+				physics->RemoveJoint(slab->PhysicBody);
+				slab->PhysicBody = NULL;
+				slab->Stress     = 0.0f;
+			}
+		}
+
+		for (int index = 0; index < slabs.Count(); index++)
+		{
+			Slab *slab = slabs[index];
+			if (slab->Purpose == Slab_Purpose_Structure && slab->PhysicBody != NULL && debris[slab->Transform.Index()])
+			{
+				physics->RemoveBody(slab->PhysicBody);
+				slab->PhysicBody = NULL;
+				slab->Transform.SetBody(NULL);
+			}
+		}
+
+		for (int index = 0; index < pins.Count(); index++)
+		{
+			Pin *pin = pins[index];
+			if (pin->PhysicBody != NULL && debris[pin->Transform.Index()])
+			{
+				physics->RemoveBody(pin->PhysicBody);
+				pin->PhysicBody = NULL;
+				pin->Transform.SetBody(NULL);
+			}
+		}
+	}
+
+	/* Works out a key for SettleCache from everything that decides how the simulation is built: the engine and
+	   settings, and every pin and slab along with where it lives in the transform store. */
+	uint64_t designKey()
+	{
+		int      settings[4] = { (int)engine, collapsePins ? 1 : 0, mergeRoads ? 1 : 0, transforms.Count() };
+		uint64_t key         = SettleCache::Hash(settings, sizeof(settings), SettleCache::Seed);
+		for (int index = 0; index < pins.Count(); index++)
+		{
+			Pin   *pin      = pins[index];
+			float  place[3] = { pin->Transform.OriginalX(), pin->Transform.OriginalY(), pin->Fixed ? 1.0f : 0.0f };
+			int    which    = pin->Transform.Index();
+			key = SettleCache::Hash(place, sizeof(place), key);
+			key = SettleCache::Hash(&which, sizeof(which), key);
+		}
+		for (int index = 0; index < slabs.Count(); index++)
+		{
+			Slab *slab     = slabs[index];
+			int   parts[4] = { slab->Transform.Index(), slab->Left->Transform.Index(), slab->Right->Transform.Index(), (int)slab->Purpose };
+			key = SettleCache::Hash(parts, sizeof(parts), key);
+		}
+		return key;
+	}
+
+	/* Lets a freshly created simulation sag into place under its own weight before anything else happens, so that
+	   the first second or so of every test isn't spent wobbling into shape. The state it comes to rest in is kept in
+	   the cache, and simply loaded the next time the same design is started. If anything snaps along the way, the
+	   bridge can't hold itself up, so the simulation is built again from scratch to show the collapse as it happens. */
+	void settle()
+	{
+		int                 count = transforms.Count();
+		uint64_t            key   = designKey();
+		SettleCache::Entry *entry = settled.Find(key);
+		if (entry != NULL && entry->Count == count * Simulation_StateSize)
+		{
+			if (!entry->Stable)
+				return;
+			physics->LoadState(transforms.Bodies(), count, entry->State);
 		}
 		else
 		{
-			slabs.Last->Next = slab;
-			slabs.Last       = slab;
+			/* At rest once nothing has moved faster than SETTLE_REST for Settle_Interval steps in a row. */
+			TransformStore::Set &current  = transforms.Get(TransformStore::Current);
+			TransformStore::Set &previous = transforms.Get(TransformStore::Previous);
+			float                limit    = SETTLE_REST * SETTLE_STEP;
+			int                  broken   = 0;
+			int                  quiet    = 0;
+			for (int step = 0; step < Settle_MaxSteps && broken == 0 && quiet < Settle_Interval; step++)
+			{
+				physics->Step(SETTLE_STEP);
+				broken += physics->HandleForces(SETTLE_STEP, BREAK_AT_FORCE);
+
+				transforms.BeginStep();
+				physics->GetTransforms(transforms.Bodies(), count, current);
+				bool moving = false;
+				for (int index = 0; index < count && !moving; index++)
+					moving = fabs(current.X[index] - previous.X[index]) > limit || fabs(current.Y[index] - previous.Y[index]) > limit;
+				quiet = moving ? 0 : quiet + 1;
+			}
+
+			entry         = settled.Store(key, count * Simulation_StateSize);
+			entry->Stable = broken == 0;
+			if (!entry->Stable)
+			{
+				createSimulation();
+				return;
+			}
+			physics->SaveState(transforms.Bodies(), count, entry->State);
 		}
 
-		return slab;
+		/* Start drawing from where it settled, rather than blending in from where it was built. */
+		physics->GetTransforms(transforms.Bodies(), count, transforms.Get(TransformStore::Current));
+		follow();
+		transforms.BeginStep();
 	}
 
 	/* This function converts the pin and slab meta-data structures into physical objects within
@@ -151,51 +903,143 @@ protected:
 	void createSimulation()
 	{
 		/* Clear any existing physics world (genocide, yay!) */
-		physics.Create();
+		physics->Create();
+		transforms.Reset();
+		followerCount = 0;
+		roads.Clear();
+		roadSlabs.Clear();
+		reserveScratch();
 
-		/* First we create bodies for the pins, so that slabs have something to attach to. */
-		Pin *pin = pins.First;
-		while (pin != NULL)
+		for (int index = 0; index < slabs.Count(); index++)
 		{
-			/* Each pin gets assigned a pointer to a physics engine body for things to latch onto. */
-			pin->Transform.Reset();
-			pin->PhysicBody = physics.AddPin(pin->Transform.X(), pin->Transform.Y(), pin->Fixed);
-			pin = pin->Next;
+			slabs[index]->Recalculate(); /* Recalculate the angle and length of the slab, as its pins may have moved. */
+			slabs[index]->PhysicBody = NULL;
+			links[index].Left  = -1;
+			links[index].Right = -1;
+			links[index].Road  = -1;
 		}
 
-		/* Now we create our different types of slabs, attaching each one to two existing pins. */
-		Slab *slab = slabs.First;
-		while (slab != NULL)
+		/* A pin between structure slabs only (think of a long road) doesn't need a body of its own, its slabs can be
+		   hinged straight to each other instead, which saves a body and a joint for every such pin.
+		   So first work out which pins do need a body: fixed ones, ones with supports (distance joints need a body at
+		   each end), and ones with nothing attached. Every other pin is "anchored" to the first structure slab
+		   attached to it, which it will follow around, the rest of its slabs being hinged to that one. Pins with
+		   exactly two slabs also remember the second one, for findRoads(). */
+		for (int index = 0; index < pins.Count(); index++)
 		{
-			slab->Recalculate(); /* Recalculate the angle and length of the slab, as its pins may have moved. */
-			switch (slab->Purpose)
+			anchors[pins[index]->Transform.Index()]  = (pins[index]->Fixed || !collapsePins) ? Anchor_Body : Anchor_None;
+			partners[pins[index]->Transform.Index()] = Anchor_None;
+		}
+		for (int index = 0; index < slabs.Count(); index++)
+		{
+			Slab *slab = slabs[index];
+			for (int end = 0; end < 2; end++)
 			{
-				case Slab_Purpose_Structure:
-					slab->PhysicBody = physics.AddStructure(slab->Left->PhysicBody, slab->Right->PhysicBody);
-					break;
-				case Slab_Purpose_Support:
-					slab->PhysicBody = physics.AddSupport(slab->Left->PhysicBody, slab->Right->PhysicBody);
-					break;
-				default:
-					break;
+				int  pin     = (end == 0 ? slab->Left : slab->Right)->Transform.Index();
+				int &anchor  = anchors[pin];
+				int &partner = partners[pin];
+				if (slab->Purpose != Slab_Purpose_Structure)
+					anchor = Anchor_Body;
+				else if (anchor == Anchor_None)
+					anchor = index;
+				else if (anchor >= 0)
+					partner = partner == Anchor_None ? index : Anchor_Body;
+			}
+		}
+
+		/* Now we create bodies for the pins that need them, so that slabs have something to attach to. */
+		for (int index = 0; index < pins.Count(); index++)
+		{
+			Pin *pin = pins[index];
+			if (anchors[pin->Transform.Index()] < 0)
+				simulatePin(pin);
+			else
+				pin->PhysicBody = NULL;
+		}
+
+		if (mergeRoads)
+			findRoads();
+
+		/* Now we create our different types of slabs, attaching each one to its pins, or to the slab its pin is
+		   anchored to. Anchor slabs always come first, so they already exist by the time anything hinges to them.
+		   Slabs welded into a road already have their body, and don't need hinging to the rest of their road. */
+		for (int index = 0; index < slabs.Count(); index++)
+		{
+			Slab *slab = slabs[index];
+			if (slab->Purpose != Slab_Purpose_Structure)
+			{
+				simulateSlab(slab);
+				continue;
+			}
+
+			if (slab->PhysicBody == NULL)
+			{
+				slab->PhysicBody = physics->AddSlab(slab->Left->Transform.X(), slab->Left->Transform.Y(), slab->Right->Transform.X(), slab->Right->Transform.Y());
+				slab->Transform.SetBody(slab->PhysicBody);
+			}
+			for (int end = 0; end < 2; end++)
+			{
+				Pin *pin    = end == 0 ? slab->Left : slab->Right;
+				int  anchor = anchors[pin->Transform.Index()];
+				if (pin->PhysicBody != NULL)
+					physics->Join(pin->PhysicBody, slab->PhysicBody, pin->Transform.X(), pin->Transform.Y());
+				else if (anchor == index)
+					addFollower(pin->Transform.Index(), rootOf(index)->Transform.Index());
+				else if (slabs[anchor]->PhysicBody != slab->PhysicBody)
+					physics->Join(slabs[anchor]->PhysicBody, slab->PhysicBody, pin->Transform.X(), pin->Transform.Y());
 			}
-			slab = slab->Next;
 		}
 
-		running = true;
+		debrisCountdown = Debris_Interval;
+		connected       = false;
+		collapsed       = false;
+		running         = true;
 	}
 
 public:
-	Bridge()
+	Bridge() : pinGrid(PIN_ACCURACY)
 	{
-		slabs.First = NULL;
-		pins.First  = NULL;
 		startPin    = NULL;
+		running     = false;
+		physics     = new PhysicsBox2D();
+		engine      = Bridge_Engine_Box2D;
+		threadPool  = NULL;
+		stepBudget  = 0.0f;
+
+		followers        = NULL;
+		followerCount    = 0;
+		followerCapacity = 0;
+		anchors          = NULL;
+		partners         = NULL;
+		anchorCapacity   = 0;
+		links            = NULL;
+		linkCapacity     = 0;
+		collapsePins     = true;
+		mergeRoads       = false;
+		debris           = NULL;
+		debrisCapacity   = 0;
+		pieces           = NULL;
+		grounded         = NULL;
+		loose            = NULL;
+		pieceCapacity    = 0;
+		connected        = false;
+		collapsed        = false;
+		debrisCountdown  = 0;
+		presettle        = true;
 	}
 
 	~Bridge()
 	{
 		Destroy();
+		delete physics;
+		delete [] followers;
+		delete [] anchors;
+		delete [] partners;
+		delete [] links;
+		delete [] debris;
+		delete [] pieces;
+		delete [] grounded;
+		delete [] loose;
 	}
 
 	bool Create()
@@ -213,27 +1057,15 @@ public:
 
 	bool Destroy()
 	{
-		/* Nuke the slabs. */
-		Slab *slab = slabs.First;
-		while (slab != NULL)
-		{
-			Slab *next = slab->Next;
-			delete slab;
-			slab = next;
-		}
-		slabs.First = NULL;
-		slabs.Last  = NULL;
-
-		/* Nuke the pins */
-		Pin *pin = pins.First;
-		while (pin != NULL)
-		{
-			Pin *next = pin->Next;
-			delete pin;
-			pin = next;
-		}
-		pins.First   = NULL;
-		pins.Last    = NULL;
+		/* Nuke the slabs and pins, the pools keep their memory around for the next bridge. */
+		slabs.Clear();
+		pins.Clear();
+		pinGrid.Clear();
+		transforms.Clear();
+		boxes.Clear();
+		followerCount = 0;
+		roads.Clear();
+		roadSlabs.Clear();
 
 		/* Reset our editing mode. */
 		startPin     = NULL;
@@ -243,107 +1075,100 @@ public:
 		return false;
 	}
 
-	/* This is called for every single "step" in the game.
-	   It is responsible for advancing the physics engine and drawing the bits of our level */
-	void Step(Renderer *Renderer)
+	/* This advances the physics engine by exactly one fixed TimeStep, then checks the forces on the joints and
+	   copies the new positions of the bodies back into our pins and slabs.
+	   The Game calls this zero or more times per frame, depending on how much real time has passed. */
+	void Simulate(float TimeStep)
 	{
-		float timeStep = Renderer->FrameRate() > 0 ? 1.0f / (float)Renderer->FrameRate() : 0.0f;
-		physics.Step(timeStep);
+		if (!running)
+			return;
 
-		Slab *slab = slabs.First;
-		while (slab)
-		{
-			switch (slab->Purpose)
-			{
-				case Slab_Purpose_Structure: /* Draw these as boxes around the X,Y co-ords of the physics entity. */
-				{
-					physics.GetTransform(slab->PhysicBody, slab->Transform);
-					float         angle  = slab->Transform.Angle();
-					float         x      = cos(angle) * (slab->Length / 2.0f);
-					float         y      = sin(angle) * (slab->Length / 2.0f);
-					Renderer->Box(slab->Transform.X(), slab->Transform.Y(), slab->Length, 0.5f, angle, 0x0000FF);
-					break;
-				}
-				case Slab_Purpose_Support: /* Draw these simply as lines between the two pins. */
-				{
-					float force = 0.0f;
-					/* Try get the force exerted on the joint, knowing that if it's too much, the joint will be deleted
-					   and the slab->PhysicBody will be set to NULL, meaning we don't need to draw it. */
-					physics.HandleSupportForce(slab->PhysicBody, timeStep, force, BREAK_AT_FORCE);
-					force = force / (float)BREAK_AT_FORCE;
+		physics->Step(TimeStep);
 
-					if (running == false || slab->PhysicBody != NULL)
-					{
-						unsigned char red    = 255;                                      /* We want the joints to show red when they are stressed, so this stays constant. */
-						unsigned char green  = (unsigned char)(255 - (force * 255.0f));  /* Green and blue must decrease with an increase in Force, so that the colour */
-						unsigned char blue   = green;                                    /* gets a red tint to it. */
-						unsigned long colour = (red << 16) + (green << 8) + (blue << 0);
-						Renderer->Line(slab->Left->Transform.X(), slab->Left->Transform.Y(), slab->Right->Transform.X(), slab->Right->Transform.Y(), colour);
-					}
-					break;
-				}
-			}
+		/* Copy the new positions of every pin, slab and box out of the physics engine in one go. */
+		transforms.BeginStep();
+		physics->GetTransforms(transforms.Bodies(), transforms.Count(), transforms.Get(TransformStore::Current));
+		follow();
+		boxes.BeginStep();
+		physics->GetTransforms(boxes.Bodies(), boxes.Count(), boxes.Get(TransformStore::Current));
 
-			slab = slab->Next;
-		}
+		/* Check the force on every joint in the bridge, breaking those that are over the limit. */
+		int broken = physics->HandleForces(TimeStep, BREAK_AT_FORCE);
+		brokenJoints += broken;
 
-		/* Optionally draw all our pins. */
-		Pin *pin = pins.First;
-		while (pin)
+		/* Remember how stressed each support is so that it can be coloured, knowing that if the joint broke,
+		   the slab->PhysicBody will be set to NULL, meaning we don't need to draw it. */
+		for (int index = 0; index < slabs.Count(); index++)
 		{
-			physics.HandlePinForce(pin->PhysicBody, timeStep, BREAK_AT_FORCE);
-			physics.GetTransform(pin->PhysicBody, pin->Transform);
-			Renderer->Circle(pin->Transform.X(), pin->Transform.Y(), 0.5f, 0x999999);
-			pin = pin->Next;
+			Slab *slab = slabs[index];
+			if (slab->Purpose == Slab_Purpose_Support)
+				slab->Stress = physics->GetJointForce(slab->PhysicBody) / (float)BREAK_AT_FORCE;
 		}
 
-		/* The rest here is simply debug stuff, drawing our debug boxes, and displaying some instructions. */
-		if (running)
+		/* The bridge is giving way, so the road needs to be able to bend, and some of it may have come away. */
+		if (broken > 0)
 		{
-			for (int box = 0; box < boxCount; box++)
-			{
-				Positioning transform;
-				physics.GetTransform(boxes[box], transform);
-				Renderer->Box(transform.X(), transform.Y(), 2.0f, 2.0f, transform.Angle(), 0xFFFFFF);
-			}
-			Renderer->Text(10,10, "Simulation Mode", 0xFFFFFF);
+			splitRoads();
+			updateConnectivity();
 		}
-		else
+
+		if (--debrisCountdown <= 0)
 		{
-			Renderer->Text(10,10, "Editing Mode", 0xFFFFFF);
+			cullDebris();
+			debrisCountdown = Debris_Interval;
 		}
-		Renderer->Text(20,20, "(toggle with SPACE)", 0x888888);
+	}
 
+	/* Copies what the bridge looks like right now into Snapshot, for drawing later, or on another thread. */
+	void Publish(BridgeSnapshot &Snapshot)
+	{
+		const char *adding = "";
 		switch (editMode)
 		{
-			case Bridge_EditMode_Support:   Renderer->Text(10,40, "Adding support beams", 0xFFFFFF); break;
-			case Bridge_EditMode_Structure: Renderer->Text(10,40, "Adding structure beams", 0xFFFFFF); break;
-			case Bridge_EditMode_Car:       Renderer->Text(10,40, "Adding debug blocks (simulation mode only)", 0xFFFFFF); break;
+			case Bridge_EditMode_Support:   adding = "Adding support beams"; break;
+			case Bridge_EditMode_Structure: adding = "Adding structure beams"; break;
+			case Bridge_EditMode_Car:       adding = "Adding debug blocks (simulation mode only)"; break;
 		}
-		Renderer->Text(20,50, "(press 1 for support, 2 for structure, 3 for blocks)", 0x888888);
+		Snapshot.Begin(transforms, boxes, running, adding,
+			engine == Bridge_Engine_Truss ? "(E swaps physics engine, using the truss solver)" : "(E swaps physics engine, using Box2D)");
 
-		Renderer->Text(10,70, "(Also press R to reset the bridge, and T to generate a test bridge)", 0x888888);
+		/* Supports that have snapped while simulating have their slab->PhysicBody set to NULL, and aren't drawn. */
+		for (int index = 0; index < slabs.Count(); index++)
+		{
+			Slab *slab = slabs[index];
+			if (slab->Purpose == Slab_Purpose_Structure)
+				Snapshot.AddStructure(slab->Transform.Index(), slab->Length);
+			else if (slab->Purpose == Slab_Purpose_Support && (running == false || slab->PhysicBody != NULL))
+				Snapshot.AddSupport(slab->Left->Transform.Index(), slab->Right->Transform.Index(), slab->Stress);
+		}
+
+		for (int index = 0; index < pins.Count(); index++)
+			Snapshot.AddPin(pins[index]->Transform.Index());
+	}
+
+	/* This draws the bits of our level, see BridgeSnapshot::Draw(). */
+	void Draw(Renderer *Renderer, float Alpha)
+	{
+		Publish(drawn);
+		drawn.Draw(Renderer, Alpha);
 	}
 
 	/* Stop the simulation, but keep the bridge in tact. */
 	void Stop()
 	{
-		physics.Destroy();
-		Slab *slab = slabs.First;
-		while (slab)
-		{
-			slab->Transform.Reset();
-			slab = slab->Next;
-		}
-		Pin *pin = pins.First;
-		while (pin)
+		physics->Destroy();
+		transforms.Reset();
+		for (int index = 0; index < slabs.Count(); index++)
 		{
-			pin->Transform.Reset();
-			pin = pin->Next;
+			slabs[index]->Stress = 0.0f;
+			slabs[index]->Recalculate(); /* Slabs added while simulating were measured between their pins' moved positions. */
 		}
 
-		memset(boxes, 0, sizeof(void*) * MAX_BLOCKS);
-		boxCount = 0;
+		boxes.Clear();
+		brokenJoints  = 0;
+		followerCount = 0;
+		roads.Clear();
+		roadSlabs.Clear();
 
 		running = false;
 	}
@@ -353,6 +1178,68 @@ public:
 	{
 		Stop();
 		createSimulation();
+		if (presettle && transforms.Count() > 0)
+			settle();
+	}
+
+	/* Lets the physics engine spread its work over the threads in Pool, or pass NULL to stay on one thread. */
+	void SetThreadPool(ThreadPool *Pool)
+	{
+		threadPool = Pool;
+		physics->SetThreadPool(Pool);
+	}
+
+	/* Lets the physics engine adjust its accuracy to keep each simulation step within Seconds, see
+	   Physics::SetStepBudget(). Zero keeps it at fixed settings. */
+	void SetStepBudget(float Seconds)
+	{
+		stepBudget = Seconds;
+		physics->SetStepBudget(Seconds);
+	}
+
+	/* Swaps to a different physics engine, stopping the simulation if it's running. */
+	void SetEngine(Bridge_Engine Engine)
+	{
+		if (Engine == engine)
+			return;
+
+		Stop();
+		delete physics;
+		switch (Engine)
+		{
+			case Bridge_Engine_Truss: physics = new PhysicsTruss(); break;
+			default:                  physics = new PhysicsBox2D(); break;
+		}
+		physics->SetThreadPool(threadPool);
+		physics->SetStepBudget(stepBudget);
+		engine = Engine;
+	}
+
+	Bridge_Engine Engine()
+	{
+		return engine;
+	}
+
+	/* Whether pins between structure slabs only are left out of the simulation, the slabs being hinged straight to
+	   each other (see createSimulation()). On by default, takes effect from the next Start(). */
+	void SetPinCollapsing(bool Collapse)
+	{
+		collapsePins = Collapse;
+	}
+
+	/* Whether straight runs of road are welded into single bodies until something breaks (see findRoads()), which
+	   needs pin collapsing to be on too. Off by default, takes effect from the next Start(). */
+	void SetRoadMerging(bool Merge)
+	{
+		mergeRoads = Merge;
+	}
+
+	/* Whether the bridge is left to sag into place under its own weight before each simulation starts (see
+	   settle()). On by default, takes effect from the next Start(). Starting a design that isn't in the cache yet
+	   runs up to Settle_MaxSteps steps there and then, which is a noticeable wait on a big bridge. */
+	void SetPresettling(bool Presettle)
+	{
+		presettle = Presettle;
 	}
 
 	void SetEditMode(Bridge_EditMode EditMode)
@@ -360,7 +1247,112 @@ public:
 		editMode = EditMode;
 	}
 
+	/* This drops a debug box of the specified Mass into the running simulation, returning false if it couldn't. */
+	bool AddBox(float X, float Y, float Mass)
+	{
+		if (!running || boxes.Count() >= MAX_BLOCKS)
+			return false;
+
+		int box = boxes.Add(X, Y, 0.0f);
+		boxes.Bodies()[box] = physics->AddBox(X, Y, Mass);
+		return true;
+	}
+
+	bool IsRunning()
+	{
+		return running;
+	}
+
+	/* Whether everything in the simulation is still held up by a fixed pin, through joints that haven't snapped.
+	   Goes false the very step a piece comes away, however slowly it then falls, and stays that way until the next
+	   Start(), even once the piece has been culled (see cullDebris()). Always true while editing. */
+	bool IsStanding()
+	{
+		if (!running)
+			return true;
+		if (!connected)
+			updateConnectivity();
+		return !collapsed;
+	}
+
+	/* Returns the piece of the running bridge that the pin at X,Y (or failing that, the slab passing closest to X,Y)
+	   is part of, or -1 if there's nothing there. Things are part of the same piece for as long as they're held
+	   together, and Grounded is set to whether the piece is held up by a fixed pin. */
+	int PieceAt(float X, float Y, bool &Grounded)
+	{
+		Grounded = false;
+		if (!running)
+			return -1;
+
+		Pin *pin = getPinAt(X, Y, PIN_ACCURACY);
+		if (pin != NULL)
+		{
+			Grounded = isGrounded(pin);
+			return pieceOf(pin);
+		}
+
+		int slab = getSlabAt(X, Y, PIN_ACCURACY);
+		if (slab < 0)
+			return -1;
+		Grounded = isGrounded(slab);
+		return pieceOf(slab);
+	}
+
+	int BrokenJoints()
+	{
+		return brokenJoints;
+	}
+
+	/* Returns how far the lowest loose pin has dropped below its edit-time position, a rough measure of how badly the bridge is holding up. */
+	float MaxSag()
+	{
+		float result = 0.0f;
+		for (int index = 0; index < pins.Count(); index++)
+		{
+			Pin   *pin = pins[index];
+			float  sag = pin->Transform.OriginalY() - pin->Transform.Y();
+			if (!pin->Fixed && sag > result)
+				result = sag;
+		}
+		return result;
+	}
+
+	/* Returns how many slabs are attached to the pin at X,Y, or -1 if there's no pin there. */
+	int SlabCountAt(float X, float Y)
+	{
+		Pin *pin = getPinAt(X, Y, PIN_ACCURACY);
+		if (pin == NULL)
+			return -1;
+
+		int result = 0;
+		for (int index = pin->FirstSlab; index >= 0; index = nextAt(slabs[index], pin))
+			result++;
+		return result;
+	}
+
+	/* Removes the loose pin at X,Y along with every slab attached to it, or failing that, the slab passing closest
+	   to X,Y. While simulating, the pieces are taken straight out of the running world, everything else carrying on
+	   from where it is. Returns false if there was nothing there to remove. */
+	bool RemoveAt(float X, float Y)
+	{
+		Pin *pin = getPinAt(X, Y, PIN_ACCURACY);
+		if (pin != NULL)
+		{
+			if (pin->Fixed)
+				return false; /* These hold the bridge to the ground. */
+			removePin(pin);
+			return true;
+		}
+
+		int slab = getSlabAt(X, Y, PIN_ACCURACY);
+		if (slab < 0)
+			return false;
+		removeSlab(slab);
+		return true;
+	}
+
 	/* This function is incredibly simple for now, accepting only co-ordinates of incoming touches/mouse clicks.
+	   While simulating, new pins and slabs go straight into the running world.
 	   It will be expanded later to include an ID and time of the touch so that multi-touch can be dealt with. */
 	void HandleTouch(float X, float Y)
 	{
@@ -368,11 +1360,7 @@ public:
 		{
 			case Bridge_EditMode_Car:
 			{
-				if (running && boxCount < MAX_BLOCKS)
-				{
-					boxes[boxCount] = physics.AddBox(X, Y, 10.0f);
-					boxCount++;
-				}
+				AddBox(X, Y, 10.0f);
 				break;
 			}
 			case Bridge_EditMode_Structure:
@@ -380,7 +1368,7 @@ public:
 			{
 				if (startPin == NULL)
 				{
-					startPin = getPinAt(X, Y, 0.5f);
+					startPin = getPinAt(X, Y, PIN_ACCURACY);
 				}
 				else
 				{
@@ -396,8 +1384,160 @@ public:
 		}
 	}
 
-	/* This simply creates a test bridge (saving the user/developer from having to click out a bridge every time).
-	   This is where our "load" function will come in future. */
+	/* This replaces the current bridge with one read from a plain text design file, returning false if the file
+	   could not be opened or contained something we didn't understand. Each line is one of:
+	     pin X Y fixed|loose
+	     structure X1 Y1 X2 Y2
+	     support X1 Y1 X2 Y2
+	   Blank lines and lines starting with # are ignored. Slabs create the pins they need, so only pins that are
+	   fixed (or otherwise unattached) need to be listed explicitly.
+	   Binary design files (see bridge_file.h) are recognised by their first few bytes and handed to LoadBinary(). */
+	bool Load(const char *Filename)
+	{
+		FILE *file = fopen(Filename, "r");
+		if (file == NULL)
+			return false;
+
+		char magic[4];
+		if (fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, BridgeFile::Magic(), sizeof(magic)) == 0)
+		{
+			fclose(file);
+			return LoadBinary(Filename);
+		}
+		rewind(file);
+
+		Destroy();
+
+		bool result = true;
+		char line[256];
+		while (result && fgets(line, sizeof(line), file) != NULL)
+		{
+			char  type[16];
+			char  state[16];
+			float x1, y1, x2, y2;
+
+			if (sscanf(line, "%15s", type) != 1 || type[0] == '#')
+				continue;
+
+			if (strcmp(type, "pin") == 0 && sscanf(line, "%*s %f %f %15s", &x1, &y1, state) == 3)
+				addPin(x1, y1)->Fixed = (strcmp(state, "fixed") == 0);
+			else if (strcmp(type, "structure") == 0 && sscanf(line, "%*s %f %f %f %f", &x1, &y1, &x2, &y2) == 4)
+				result = (addSlab(x1, y1, x2, y2, Slab_Purpose_Structure) != NULL);
+			else if (strcmp(type, "support") == 0 && sscanf(line, "%*s %f %f %f %f", &x1, &y1, &x2, &y2) == 4)
+				result = (addSlab(x1, y1, x2, y2, Slab_Purpose_Support) != NULL);
+			else
+				result = false;
+		}
+
+		fclose(file);
+		return result;
+	}
+
+	/* This writes the current bridge out in the format that Load() reads. */
+	bool Save(const char *Filename)
+	{
+		FILE *file = fopen(Filename, "w");
+		if (file == NULL)
+			return false;
+
+		fprintf(file, "# BridgeBuilder design\n");
+		for (int index = 0; index < pins.Count(); index++)
+		{
+			Pin *pin = pins[index];
+			fprintf(file, "pin %g %g %s\n", pin->Transform.OriginalX(), pin->Transform.OriginalY(), pin->Fixed ? "fixed" : "loose");
+		}
+
+		for (int index = 0; index < slabs.Count(); index++)
+		{
+			Slab *slab = slabs[index];
+			fprintf(file, "%s %g %g %g %g\n", slab->Purpose == Slab_Purpose_Structure ? "structure" : "support",
+				slab->Left->Transform.OriginalX(), slab->Left->Transform.OriginalY(), slab->Right->Transform.OriginalX(), slab->Right->Transform.OriginalY());
+		}
+
+		return fclose(file) == 0;
+	}
+
+	/* This replaces the current bridge with one from a binary design file, returning false (and leaving no bridge) if
+	   it isn't one, or holds something no bridge could: pins that aren't anywhere, slabs between pins that aren't
+	   there, or with no length. The file is mapped rather than read, and the pins and slabs
+	   are built straight from its tables in one pass, with none of the searching for existing pins that Load() does. */
+	bool LoadBinary(const char *Filename)
+	{
+		BridgeFile file;
+		if (!file.Open(Filename))
+			return false;
+
+		Destroy();
+
+		const BridgeFile_Header *header = file.Header();
+		const BridgeFile_Pin    *pin    = file.Pins();
+		for (uint32_t index = 0; index < header->PinCount; index++, pin++)
+		{
+			if (!isfinite(pin->X) || !isfinite(pin->Y))
+				return Destroy();
+			pinGrid.Add(new (pins.Allocate()) Pin(&transforms, pin->X, pin->Y, (pin->Flags & BridgeFile_Fixed) != 0));
+		}
+
+		const BridgeFile_Slab *slab = file.Slabs();
+		for (uint32_t index = 0; index < header->SlabCount; index++, slab++)
+		{
+			if (slab->Left >= header->PinCount || slab->Right >= header->PinCount)
+				return Destroy();
+
+			const BridgeFile_Pin &first  = file.Pins()[slab->Left];
+			const BridgeFile_Pin &second = file.Pins()[slab->Right];
+			if (first.X == second.X && first.Y == second.Y)
+				return Destroy(); /* Which includes a slab from a pin to itself. */
+
+			Pin *left  = pins[slab->Left];
+			Pin *right = pins[slab->Right];
+			switch (slab->Purpose)
+			{
+				case Slab_Purpose_Support:
+					new (slabs.Allocate()) SlabSupport(&transforms, left, right);
+					break;
+				case Slab_Purpose_Structure:
+					new (slabs.Allocate()) SlabStructure(&transforms, left, right);
+					break;
+				default:
+					return Destroy();
+			}
+			attach(slabs.Count() - 1);
+		}
+		return true;
+	}
+
+	/* This writes the current bridge out in the format that LoadBinary() reads, as it was built. */
+	bool SaveBinary(const char *Filename)
+	{
+		BridgeFile_Pin  *pinTable  = new BridgeFile_Pin[pins.Count() + 1];
+		BridgeFile_Slab *slabTable = new BridgeFile_Slab[slabs.Count() + 1];
+
+		/* Slabs only point at their pins, so the pin indices are filled in while walking each pin's list of slabs. */
+		for (int index = 0; index < pins.Count(); index++)
+		{
+			Pin *pin = pins[index];
+			pinTable[index].X     = pin->Transform.OriginalX();
+			pinTable[index].Y     = pin->Transform.OriginalY();
+			pinTable[index].Flags = pin->Fixed ? BridgeFile_Fixed : 0;
+			for (int slab = pin->FirstSlab; slab >= 0; slab = nextAt(slabs[slab], pin))
+			{
+				if (slabs[slab]->Left == pin)
+					slabTable[slab].Left = index;
+				if (slabs[slab]->Right == pin)
+					slabTable[slab].Right = index;
+			}
+		}
+		for (int index = 0; index < slabs.Count(); index++)
+			slabTable[index].Purpose = slabs[index]->Purpose;
+
+		bool result = BridgeFile::Write(Filename, pinTable, pins.Count(), slabTable, slabs.Count());
+		delete [] pinTable;
+		delete [] slabTable;
+		return result;
+	}
+
+	/* This simply creates a test bridge (saving the user/developer from having to click out a bridge every time). */
 	void CreateTestBridge()
 	{
 		int   slabCount     = 5;
@@ -0,0 +1,196 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef __BRIDGE_FILE_H_
+#define __BRIDGE_FILE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* This is the binary bridge design format, for when there are far too many designs for parsing text to be
+   acceptable (see Bridge::Load() and Bridge::SaveBinary()).
+
+   A file is a BridgeFile_Header followed straight away by PinCount BridgeFile_Pins, then SlabCount BridgeFile_Slabs,
+   each slab referring to its pins by their index in the pin table. Everything is 4 bytes wide and stored in the
+   machine's own byte order (little endian everywhere we care about), so a mapped file can be read as is. */
+enum
+{
+	BridgeFile_Version = 1, /* Bump this whenever the layout below changes. */
+	BridgeFile_Fixed   = 1, /* BridgeFile_Pin::Flags bit for pins attached to the ground. */
+};
+
+struct BridgeFile_Header
+{
+	char      Magic[4];     /* Always "BRDG". */
+	uint32_t  Version;
+	uint32_t  PinCount;
+	uint32_t  SlabCount;
+};
+
+struct BridgeFile_Pin
+{
+	float     X;
+	float     Y;
+	uint32_t  Flags;
+};
+
+struct BridgeFile_Slab
+{
+	uint32_t  Left;         /* Indices into the pin table. */
+	uint32_t  Right;
+	uint32_t  Purpose;      /* A Slab_Purpose. */
+};
+
+static_assert(sizeof(BridgeFile_Header) == 16 && sizeof(BridgeFile_Pin) == 12 && sizeof(BridgeFile_Slab) == 12, "Design file records must not be padded");
+
+/* Maps a binary design file into memory read only, and checks that it is one, and complete, before handing out
+   pointers to its tables. Nothing is copied, the pointers are only good until Close(). */
+class BridgeFile
+{
+public:
+	static const char *Magic() { return "BRDG"; }
+
+protected:
+	const unsigned char *data;
+	size_t               size;
+#ifdef _WIN32
+	HANDLE               file;
+	HANDLE               mapping;
+#endif
+
+public:
+	BridgeFile()
+	{
+		data = NULL;
+		size = 0;
+	}
+
+	~BridgeFile()
+	{
+		Close();
+	}
+
+	/* Returns false if Filename can't be mapped, isn't a design file of this version, or is cut short. */
+	bool Open(const char *Filename)
+	{
+		Close();
+#ifdef _WIN32
+		file = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER length;
+		mapping = NULL;
+		if (GetFileSizeEx(file, &length) && length.QuadPart >= (LONGLONG)sizeof(BridgeFile_Header))
+			mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL)
+		{
+			CloseHandle(file);
+			return false;
+		}
+		size = (size_t)length.QuadPart;
+		data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (data == NULL)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+		}
+#else
+		int handle = open(Filename, O_RDONLY);
+		if (handle < 0)
+			return false;
+		struct stat info;
+		if (fstat(handle, &info) == 0 && info.st_size >= (off_t)sizeof(BridgeFile_Header))
+		{
+			void *mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, handle, 0);
+			if (mapped != MAP_FAILED)
+			{
+				data = (const unsigned char*)mapped;
+				size = (size_t)info.st_size;
+				madvise(mapped, size, MADV_SEQUENTIAL); /* We only ever read it front to back, once. */
+			}
+		}
+		close(handle); /* The mapping keeps the file around. */
+#endif
+		if (data == NULL)
+			return false;
+
+		/* Counts are checked against the size in 64 bits, so a nonsense header can't wrap around to look fine. */
+		const BridgeFile_Header *header = Header();
+		uint64_t needed = sizeof(BridgeFile_Header) + (uint64_t)header->PinCount * sizeof(BridgeFile_Pin) + (uint64_t)header->SlabCount * sizeof(BridgeFile_Slab);
+		if (memcmp(header->Magic, Magic(), 4) != 0 || header->Version != BridgeFile_Version || needed > size)
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void Close()
+	{
+		if (data == NULL)
+			return;
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+		CloseHandle(mapping);
+		CloseHandle(file);
+#else
+		munmap((void*)data, size);
+#endif
+		data = NULL;
+		size = 0;
+	}
+
+	const BridgeFile_Header* Header() const
+	{
+		return (const BridgeFile_Header*)data;
+	}
+
+	const BridgeFile_Pin* Pins() const
+	{
+		return (const BridgeFile_Pin*)(data + sizeof(BridgeFile_Header));
+	}
+
+	const BridgeFile_Slab* Slabs() const
+	{
+		return (const BridgeFile_Slab*)(data + sizeof(BridgeFile_Header) + Header()->PinCount * sizeof(BridgeFile_Pin));
+	}
+
+	/* Writes a design out from the given tables, returning false if it couldn't all be written. */
+	static bool Write(const char *Filename, const BridgeFile_Pin *Pins, uint32_t PinCount, const BridgeFile_Slab *Slabs, uint32_t SlabCount)
+	{
+		FILE *file = fopen(Filename, "wb");
+		if (file == NULL)
+			return false;
+
+		BridgeFile_Header header;
+		memcpy(header.Magic, Magic(), 4);
+		header.Version   = BridgeFile_Version;
+		header.PinCount  = PinCount;
+		header.SlabCount = SlabCount;
+
+		bool result = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		              fwrite(Pins,  sizeof(BridgeFile_Pin),  PinCount,  file) == PinCount &&
+		              fwrite(Slabs, sizeof(BridgeFile_Slab), SlabCount, file) == SlabCount;
+		return (fclose(file) == 0) && result;
+	}
+};
+
+#endif
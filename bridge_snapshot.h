@@ -0,0 +1,272 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __BRIDGE_SNAPSHOT_H_
+#define __BRIDGE_SNAPSHOT_H_
+
+#include <string.h>
+#include "clipping.h"
+#include "renderer.h"
+#include "transform_store.h"
+
+/* This is a copy of everything needed to draw a bridge as it was after some simulation step: the last two states of
+   every transform (so drawing can still blend between steps), which of them are slabs, supports and pins, and what
+   the HUD says. Bridge::Publish() fills one in, and Draw() then only ever reads from the snapshot, never the Bridge,
+   so the simulation can carry on changing the bridge on another thread while a snapshot is drawn (see
+   SimulationThread).
+
+   Filling one in only copies a few flat arrays, the memory being kept for the next time. */
+class BridgeSnapshot
+{
+public:
+	double           Time;            /* For whoever publishes it, e.g., when the Current transforms are due. */
+
+protected:
+	TransformStore   transforms;      /* Only the Previous and Current sets are filled in, Drawn is worked out by Draw(). */
+	TransformStore   boxes;
+
+	int             *structures;      /* The transform index of each structure slab... */
+	float           *lengths;         /* ... and its length. */
+	int              structureCount;
+	int              structureCapacity;
+
+	int             *supportLeft;     /* The transform indices of the pins at either end of each support still standing... */
+	int             *supportRight;
+	float           *stresses;        /* ... and how close it is to snapping. */
+	int              supportCount;
+	int              supportCapacity;
+
+	int             *pins;            /* The transform index of each pin. */
+	int              pinCount;
+	int              pinCapacity;
+
+	bool             running;
+	const char      *adding;          /* What clicking does, and which engine is in use, for the HUD. */
+	const char      *engine;
+
+	template<class T>
+	static void grow(T *&Array, int Count, int Capacity)
+	{
+		T *result = new T[Capacity];
+		if (Count > 0)
+			memcpy(result, Array, sizeof(T) * Count);
+		delete [] Array;
+		Array = result;
+	}
+
+	static int growth(int Capacity)
+	{
+		return Capacity > 0 ? Capacity * 2 : 256;
+	}
+
+public:
+	BridgeSnapshot()
+	{
+		Time              = 0.0;
+		structures        = NULL;
+		lengths           = NULL;
+		structureCount    = 0;
+		structureCapacity = 0;
+		supportLeft       = NULL;
+		supportRight      = NULL;
+		stresses          = NULL;
+		supportCount      = 0;
+		supportCapacity   = 0;
+		pins              = NULL;
+		pinCount          = 0;
+		pinCapacity       = 0;
+		running           = false;
+		adding            = "";
+		engine            = "";
+	}
+
+	~BridgeSnapshot()
+	{
+		delete [] structures;
+		delete [] lengths;
+		delete [] supportLeft;
+		delete [] supportRight;
+		delete [] stresses;
+		delete [] pins;
+	}
+
+	/* Starts a new snapshot, copying the transforms of the bridge and its debug boxes. Adding and Engine must be
+	   strings that stay around, such as literals. */
+	void Begin(TransformStore &Transforms, TransformStore &Boxes, bool Running, const char *Adding, const char *Engine)
+	{
+		transforms.CopyFrom(Transforms);
+		boxes.CopyFrom(Boxes);
+		structureCount = 0;
+		supportCount   = 0;
+		pinCount       = 0;
+		running        = Running;
+		adding         = Adding;
+		engine         = Engine;
+	}
+
+	void AddStructure(int Transform, float Length)
+	{
+		if (structureCount == structureCapacity)
+		{
+			int capacity = growth(structureCapacity);
+			grow(structures, structureCount, capacity);
+			grow(lengths,    structureCount, capacity);
+			structureCapacity = capacity;
+		}
+		structures[structureCount] = Transform;
+		lengths[structureCount++]  = Length;
+	}
+
+	void AddSupport(int Left, int Right, float Stress)
+	{
+		if (supportCount == supportCapacity)
+		{
+			int capacity = growth(supportCapacity);
+			grow(supportLeft,  supportCount, capacity);
+			grow(supportRight, supportCount, capacity);
+			grow(stresses,     supportCount, capacity);
+			supportCapacity = capacity;
+		}
+		supportLeft[supportCount]  = Left;
+		supportRight[supportCount] = Right;
+		stresses[supportCount++]   = Stress;
+	}
+
+	void AddPin(int Transform)
+	{
+		if (pinCount == pinCapacity)
+		{
+			int capacity = growth(pinCapacity);
+			grow(pins, pinCount, capacity);
+			pinCapacity = capacity;
+		}
+		pins[pinCount++] = Transform;
+	}
+
+	/* This draws the bits of our level. Alpha is how far we are between the previous and the current simulation step,
+	   so that movement looks smooth even when the frame rate and simulation rate differ. */
+	void Draw(Renderer *Renderer, float Alpha)
+	{
+		transforms.Interpolate(Alpha);
+		boxes.Interpolate(Alpha);
+
+		/* Everything is gathered into arrays on the stack and handed to the renderer a batch at a time, so that it can
+		   work out the screen positions of lots of primitives at once. Anything that is nowhere near the renderer's
+		   view is skipped altogether, which matters once you zoom in on part of a big bridge. */
+		const int            batch = Renderer::BatchSize;
+		TransformStore::Set &drawn = transforms.Get(TransformStore::Drawn);
+		float                viewLeft, viewBottom, viewRight, viewTop;
+		Renderer->GetView(viewLeft, viewBottom, viewRight, viewTop);
+
+		/* Structure slabs are drawn as boxes around the X,Y co-ords of the physics entity... */
+		float         boxX[batch], boxY[batch], boxWidth[batch], boxHeight[batch], boxCosine[batch], boxSine[batch];
+		int           boxCount  = 0;
+		for (int index = 0; index < structureCount; index++)
+		{
+			int   which  = structures[index];
+			float extent = lengths[index] / 2.0f + 0.25f; /* Half the length plus half the thickness covers any rotation. */
+			if (!Clipping::Overlaps(drawn.X[which] - extent, drawn.Y[which] - extent, drawn.X[which] + extent, drawn.Y[which] + extent, viewLeft, viewBottom, viewRight, viewTop))
+				continue;
+
+			boxX[boxCount]      = drawn.X[which];
+			boxY[boxCount]      = drawn.Y[which];
+			boxWidth[boxCount]  = lengths[index];
+			boxHeight[boxCount] = 0.5f;
+			boxCosine[boxCount] = drawn.Cosine[which];
+			boxSine[boxCount]   = drawn.Sine[which];
+			if (++boxCount == batch)
+			{
+				Renderer->Boxes(boxX, boxY, boxWidth, boxHeight, boxCosine, boxSine, 0x0000FF, boxCount);
+				boxCount = 0;
+			}
+		}
+		Renderer->Boxes(boxX, boxY, boxWidth, boxHeight, boxCosine, boxSine, 0x0000FF, boxCount);
+
+		/* ... and supports simply as lines between the two pins. */
+		float         lineX0[batch], lineY0[batch], lineX1[batch], lineY1[batch];
+		unsigned long lineColour[batch];
+		int           lineCount = 0;
+		for (int index = 0; index < supportCount; index++)
+		{
+			float         force  = stresses[index];
+			unsigned char red    = 255;                                      /* We want the joints to show red when they are stressed, so this stays constant. */
+			unsigned char green  = (unsigned char)(255 - (force * 255.0f));  /* Green and blue must decrease with an increase in Force, so that the colour */
+			unsigned char blue   = green;                                    /* gets a red tint to it. */
+			int           left   = supportLeft[index];
+			int           right  = supportRight[index];
+			float         minX   = drawn.X[left] < drawn.X[right] ? drawn.X[left] : drawn.X[right];
+			float         maxX   = drawn.X[left] < drawn.X[right] ? drawn.X[right] : drawn.X[left];
+			float         minY   = drawn.Y[left] < drawn.Y[right] ? drawn.Y[left] : drawn.Y[right];
+			float         maxY   = drawn.Y[left] < drawn.Y[right] ? drawn.Y[right] : drawn.Y[left];
+			if (!Clipping::Overlaps(minX, minY, maxX, maxY, viewLeft, viewBottom, viewRight, viewTop))
+				continue;
+
+			lineX0[lineCount]     = drawn.X[left];
+			lineY0[lineCount]     = drawn.Y[left];
+			lineX1[lineCount]     = drawn.X[right];
+			lineY1[lineCount]     = drawn.Y[right];
+			lineColour[lineCount] = (red << 16) + (green << 8) + (blue << 0);
+			if (++lineCount == batch)
+			{
+				Renderer->Lines(lineX0, lineY0, lineX1, lineY1, lineColour, lineCount);
+				lineCount = 0;
+			}
+		}
+		Renderer->Lines(lineX0, lineY0, lineX1, lineY1, lineColour, lineCount);
+
+		/* Optionally draw all our pins. The X and Y arrays of the boxes are free again, so they're reused here. */
+		int drawnPins = 0;
+		for (int index = 0; index < pinCount; index++)
+		{
+			int which = pins[index];
+			if (!Clipping::Overlaps(drawn.X[which] - 0.5f, drawn.Y[which] - 0.5f, drawn.X[which] + 0.5f, drawn.Y[which] + 0.5f, viewLeft, viewBottom, viewRight, viewTop))
+				continue;
+
+			boxX[drawnPins] = drawn.X[which];
+			boxY[drawnPins] = drawn.Y[which];
+			if (++drawnPins == batch)
+			{
+				Renderer->Circles(boxX, boxY, 0.5f, 0x999999, drawnPins);
+				drawnPins = 0;
+			}
+		}
+		Renderer->Circles(boxX, boxY, 0.5f, 0x999999, drawnPins);
+
+		/* The rest here is simply debug stuff, drawing our debug boxes, and displaying some instructions. */
+		if (running)
+		{
+			/* The debug boxes are already in arrays, so they only need their sizes filling in. */
+			TransformStore::Set &box = boxes.Get(TransformStore::Drawn);
+			for (int index = 0; index < batch; index++)
+				boxWidth[index] = boxHeight[index] = 2.0f;
+			for (int start = 0; start < boxes.Count(); start += batch)
+			{
+				int count = boxes.Count() - start < batch ? boxes.Count() - start : batch;
+				Renderer->Boxes(box.X + start, box.Y + start, boxWidth, boxHeight, box.Cosine + start, box.Sine + start, 0xFFFFFF, count);
+			}
+			Renderer->Text(10,10, "Simulation Mode", 0xFFFFFF);
+		}
+		else
+		{
+			Renderer->Text(10,10, "Editing Mode", 0xFFFFFF);
+		}
+		Renderer->Text(20,20, "(toggle with SPACE)", 0x888888);
+
+		Renderer->Text(10,40, adding, 0xFFFFFF);
+		Renderer->Text(20,50, "(press 1 for support, 2 for structure, 3 for blocks)", 0x888888);
+		Renderer->Text(20,60, "(right click removes a pin or slab, even while simulating)", 0x888888);
+
+		Renderer->Text(10,70, "(Also press R to reset the bridge, and T to generate a test bridge)", 0x888888);
+		Renderer->Text(10,80, engine, 0x888888);
+	}
+};
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __CLIPPING_H_
+#define __CLIPPING_H_
+
+/* Bits and pieces for working out which parts of primitives land inside a rectangle, be it the screen in pixels or
+   the view in world co-ordinates. Rectangles are given as Left, Top, Right, Bottom with Left <= Right and
+   Top <= Bottom, i.e., "Top" is simply the smaller of the two Y values, which in world co-ordinates is the bottom. */
+class Clipping
+{
+protected:
+	/* One step of Liang-Barsky: narrows Enter..Leave down to the part of the line on the inside of one edge. */
+	static bool edge(float Towards, float Distance, float &Enter, float &Leave)
+	{
+		if (Towards == 0.0f)
+			return Distance >= 0.0f; /* Parallel to the edge, so either all inside or all outside. */
+
+		float at = Distance / Towards;
+		if (Towards < 0.0f)
+		{
+			if (at > Leave)
+				return false;
+			if (at > Enter)
+				Enter = at;
+		}
+		else
+		{
+			if (at < Enter)
+				return false;
+			if (at < Leave)
+				Leave = at;
+		}
+		return true;
+	}
+
+public:
+	/* Returns whether the rectangle Left..Right, Top..Bottom overlaps the clipping rectangle at all. */
+	static bool Overlaps(float Left, float Top, float Right, float Bottom, float ClipLeft, float ClipTop, float ClipRight, float ClipBottom)
+	{
+		return Left <= ClipRight && Right >= ClipLeft && Top <= ClipBottom && Bottom >= ClipTop;
+	}
+
+	/* Cuts the line X0,Y0 to X1,Y1 down to the part inside the clipping rectangle, using the Liang-Barsky algorithm.
+	   Returns false, leaving the line alone, if none of it is inside. */
+	static bool Line(float &X0, float &Y0, float &X1, float &Y1, float ClipLeft, float ClipTop, float ClipRight, float ClipBottom)
+	{
+		float deltaX = X1 - X0;
+		float deltaY = Y1 - Y0;
+		float enter  = 0.0f;
+		float leave  = 1.0f;
+
+		if (!edge(-deltaX, X0 - ClipLeft,   enter, leave) ||
+		    !edge( deltaX, ClipRight - X0,  enter, leave) ||
+		    !edge(-deltaY, Y0 - ClipTop,    enter, leave) ||
+		    !edge( deltaY, ClipBottom - Y0, enter, leave))
+			return false;
+
+		float x0 = X0, y0 = Y0;
+		if (leave < 1.0f)
+		{
+			X1 = x0 + leave * deltaX;
+			Y1 = y0 + leave * deltaY;
+		}
+		if (enter > 0.0f)
+		{
+			X0 = x0 + enter * deltaX;
+			Y0 = y0 + enter * deltaY;
+		}
+		return true;
+	}
+};
+
+#endif
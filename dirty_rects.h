@@ -0,0 +1,153 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __DIRTY_RECTS_H_
+#define __DIRTY_RECTS_H_
+
+/* This keeps a short list of screen rectangles that have been drawn to, so that a renderer only has to clear and
+   present those areas instead of the whole screen.
+   Rectangles that overlap a new one are merged with it. Once the list is full, a new rectangle is merged into
+   whichever existing one grows the least by taking it on, so the list never grows past MaxRects but still covers
+   everything that was added. */
+class DirtyRects
+{
+public:
+	enum
+	{
+		MaxRects = 64,
+	};
+
+	/* A rectangle in screen pixels, Right and Bottom being one past the last pixel. */
+	struct Rect
+	{
+		int Left;
+		int Top;
+		int Right;
+		int Bottom;
+	};
+
+protected:
+	Rect rects[MaxRects];
+	int  count;
+	int  width;
+	int  height;
+
+	static int area(const Rect &Rect)
+	{
+		return (Rect.Right - Rect.Left) * (Rect.Bottom - Rect.Top);
+	}
+
+	static void merge(Rect &Into, const Rect &From)
+	{
+		if (From.Left   < Into.Left)   Into.Left   = From.Left;
+		if (From.Top    < Into.Top)    Into.Top    = From.Top;
+		if (From.Right  > Into.Right)  Into.Right  = From.Right;
+		if (From.Bottom > Into.Bottom) Into.Bottom = From.Bottom;
+	}
+
+	static bool overlaps(const Rect &Left, const Rect &Right)
+	{
+		return Left.Left < Right.Right && Right.Left < Left.Right && Left.Top < Right.Bottom && Right.Top < Left.Bottom;
+	}
+
+public:
+	DirtyRects()
+	{
+		count  = 0;
+		width  = 0;
+		height = 0;
+	}
+
+	/* Sets the size of the screen, rectangles are clipped to it. */
+	void SetBounds(int Width, int Height)
+	{
+		width  = Width;
+		height = Height;
+	}
+
+	void Clear()
+	{
+		count = 0;
+	}
+
+	/* Marks the whole screen as dirty. */
+	void All()
+	{
+		count = 0;
+		Add(0, 0, width, height);
+	}
+
+	/* Marks the pixels Left..Right-1, Top..Bottom-1 as dirty. */
+	void Add(int Left, int Top, int Right, int Bottom)
+	{
+		Rect rect;
+		rect.Left   = Left   < 0      ? 0      : Left;
+		rect.Top    = Top    < 0      ? 0      : Top;
+		rect.Right  = Right  > width  ? width  : Right;
+		rect.Bottom = Bottom > height ? height : Bottom;
+		if (rect.Left >= rect.Right || rect.Top >= rect.Bottom)
+			return;
+
+		Add(rect);
+	}
+
+	void Add(const Rect &Rect)
+	{
+		for (int index = 0; index < count; index++)
+		{
+			if (overlaps(rects[index], Rect))
+			{
+				merge(rects[index], Rect);
+				return;
+			}
+		}
+
+		if (count < MaxRects)
+		{
+			rects[count++] = Rect;
+			return;
+		}
+
+		int best       = 0;
+		int bestGrowth = -1;
+		for (int index = 0; index < count; index++)
+		{
+			struct Rect grown = rects[index];
+			merge(grown, Rect);
+			int growth = area(grown) - area(rects[index]);
+			if (bestGrowth < 0 || growth < bestGrowth)
+			{
+				best       = index;
+				bestGrowth = growth;
+			}
+		}
+		merge(rects[best], Rect);
+	}
+
+	/* Adds all of Other's rectangles to this list. */
+	void Add(const DirtyRects &Other)
+	{
+		for (int index = 0; index < Other.count; index++)
+			Add(Other.rects[index]);
+	}
+
+	int Count() const
+	{
+		return count;
+	}
+
+	const Rect& Get(int Index) const
+	{
+		return rects[Index];
+	}
+};
+
+#endif
@@ -0,0 +1,455 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __DRAW_LIST_H_
+#define __DRAW_LIST_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "text_cache.h"
+
+typedef enum DrawCommand_Type
+{
+	DrawCommand_Line = 0,
+	DrawCommand_Circle,
+	DrawCommand_Text,
+}
+DrawCommand_Type;
+
+/* One recorded drawing primitive, already converted to screen pixels. */
+struct DrawCommand
+{
+	DrawCommand_Type  Type;
+	int               X0;      /* Line start, circle centre, or top-left of the text. */
+	int               Y0;
+	int               X1;      /* Line end, or bottom-right of the text. */
+	int               Y1;
+	float             Radius;  /* Circle radius in pixels. */
+	bool              Clipped; /* The circle hangs over the edge of the buffer, so each pixel must be checked. */
+	int               Text;    /* Where the string starts in the DrawList's text buffer. */
+	unsigned long     Colour;
+};
+
+/* An area of a pixel buffer, Right and Bottom being one past the last pixel. */
+struct DrawArea
+{
+	int Left;
+	int Top;
+	int Right;
+	int Bottom;
+};
+
+/* This records the primitives drawn during a frame instead of drawing them straight away, so that a renderer can
+   draw the whole frame in one go at the end (e.g., with the surface locked only once), and so that a frame can be
+   looked at or drawn again without involving SDL at all.
+
+   Before drawing, Sort() orders the commands by the band of rows they start in, so that the drawing works its way
+   down the buffer instead of jumping all over it. The sort is stable, and text always comes after everything else,
+   so the HUD stays on top. Commands in the same band keep the order they were recorded in. */
+class DrawList
+{
+public:
+	typedef uint32_t Pixel;
+
+	enum
+	{
+		BandHeight = 32, /* How many rows of pixels make up a band when sorting. */
+	};
+
+protected:
+	DrawCommand *commands;
+	DrawCommand *sorted;      /* Scratch space for Sort(). */
+	int          count;
+	int          capacity;
+	char        *text;        /* Every recorded string, one after the other with their terminators. */
+	int          textLength;
+	int          textCapacity;
+	int         *bandCounts;
+	int          bandCapacity;
+	TextCache    texts;       /* Remembers the pixels of strings drawn in previous frames, the HUD being the same most of the time. */
+
+	DrawCommand& add(DrawCommand_Type Type, unsigned long Colour)
+	{
+		if (count == capacity)
+		{
+			int          grown    = capacity > 0 ? capacity * 2 : 1024;
+			DrawCommand *commands = new DrawCommand[grown];
+			if (count > 0)
+				memcpy(commands, this->commands, sizeof(DrawCommand) * count);
+			delete [] this->commands;
+			delete [] sorted;
+			this->commands = commands;
+			sorted         = new DrawCommand[grown];
+			capacity       = grown;
+		}
+
+		DrawCommand &command = commands[count++];
+		command.Type   = Type;
+		command.Colour = Colour;
+		command.Radius = 0.0f;
+		command.Clipped = false;
+		command.Text   = -1;
+		return command;
+	}
+
+	/* The first row a command touches, which is what it gets sorted by. */
+	static int top(const DrawCommand &Command)
+	{
+		switch (Command.Type)
+		{
+			case DrawCommand_Line:   return Command.Y0 < Command.Y1 ? Command.Y0 : Command.Y1;
+			case DrawCommand_Circle: return (int)(Command.Y0 - Command.Radius);
+			default:                 return Command.Y0;
+		}
+	}
+
+	static bool inside(const DrawArea &Clip, int X, int Y)
+	{
+		return X >= Clip.Left && X < Clip.Right && Y >= Clip.Top && Y < Clip.Bottom;
+	}
+
+	/* Draws a line using the Bresenham algorithm. When Checked, only the pixels inside Clip are drawn, which the
+	   compiler throws away entirely for the unchecked version. */
+	template<bool Checked>
+	static void rasterLine(Pixel *Buffer, int Stride, const DrawArea &Clip, const DrawCommand &Command)
+	{
+		int          x0     = Command.X0;
+		int          y0     = Command.Y0;
+		int          x1     = Command.X1;
+		int          y1     = Command.Y1;
+		int          xinc   = 1;
+		int          yinc   = Stride;
+		int          ystep  = 1;
+		int          xspan  = x1 - x0 + 1;
+		int          yspan  = y1 - y0 + 1;
+
+		if (xspan < 0)
+		{
+			xinc  = -xinc;
+			xspan = -xspan;
+		}
+		if (yspan < 0)
+		{
+			yinc  = -yinc;
+			ystep = -ystep;
+			yspan = -yspan;
+		}
+
+		int  sum         = 0;
+		int  drawpos     = Stride * y0 + x0;
+		int  x           = x0;
+		int  y           = y0;
+
+		bool yBigger     = (xspan < yspan);
+		int  iMax        = yBigger ? yspan : xspan;
+		int  sumInc      = yBigger ? xspan : yspan;
+		int  posInc      = yBigger ? xinc  : yinc;
+		int  compare     = yBigger ? yspan : xspan;
+		int  finalPosInc = yBigger ? yinc  : xinc;
+		int  stepX       = yBigger ? xinc  : 0;      /* How x and y change along with posInc and finalPosInc. */
+		int  stepY       = yBigger ? 0     : ystep;
+		int  finalStepX  = yBigger ? 0     : xinc;
+		int  finalStepY  = yBigger ? ystep : 0;
+
+		for (int i = 0; i < iMax; i++)
+		{
+			if (!Checked || inside(Clip, x, y))
+				Buffer[drawpos] = Command.Colour;
+			sum += sumInc;
+			if (sum >= compare)
+			{
+				drawpos += posInc;
+				x       += stepX;
+				y       += stepY;
+				sum -= compare;
+			}
+			drawpos += finalPosInc;
+			x       += finalStepX;
+			y       += finalStepY;
+		}
+	}
+
+	template<bool Checked>
+	static void plot(Pixel *Buffer, int Stride, const DrawArea &Clip, int X, int Y, Pixel Colour)
+	{
+		if (!Checked || inside(Clip, X, Y))
+			Buffer[X + Y * Stride] = Colour;
+	}
+
+	/* Draws a circle using the Bresenham algorithm, see rasterLine() for Checked. */
+	template<bool Checked>
+	static void rasterCircle(Pixel *Buffer, int Stride, const DrawArea &Clip, const DrawCommand &Command)
+	{
+		Pixel  colour = Command.Colour;
+		double error  = (double)-Command.Radius;
+		double x      = (double)Command.Radius - 0.5;
+		double y      = (double)0.5;
+		double cx     = Command.X0 - 0.5f;
+		double cy     = Command.Y0 - 0.5f;
+
+		while (x >= y)
+		{
+			plot<Checked>(Buffer, Stride, Clip, (int)(cx + x), (int)(cy + y), colour);
+			plot<Checked>(Buffer, Stride, Clip, (int)(cx + y), (int)(cy + x), colour);
+
+			if (x != 0)
+			{
+				plot<Checked>(Buffer, Stride, Clip, (int)(cx - x), (int)(cy + y), colour);
+				plot<Checked>(Buffer, Stride, Clip, (int)(cx + y), (int)(cy - x), colour);
+			}
+
+			if (y != 0)
+			{
+				plot<Checked>(Buffer, Stride, Clip, (int)(cx + x), (int)(cy - y), colour);
+				plot<Checked>(Buffer, Stride, Clip, (int)(cx - y), (int)(cy + x), colour);
+			}
+
+			if (x != 0 && y != 0)
+			{
+				plot<Checked>(Buffer, Stride, Clip, (int)(cx - x), (int)(cy - y), colour);
+				plot<Checked>(Buffer, Stride, Clip, (int)(cx - y), (int)(cy - x), colour);
+			}
+
+			error += y;
+			++y;
+			error += y;
+
+			if (error >= 0)
+			{
+				--x;
+				error -= x;
+				error -= x;
+			}
+		}
+	}
+
+	/* Draws a string using the small built in font, see TextCache. */
+	void rasterText(Pixel *Buffer, int Stride, const DrawCommand &Command)
+	{
+		texts.Draw(Buffer, Stride, Command.X0, Command.Y0, text + Command.Text, Command.Colour);
+	}
+
+public:
+	DrawList()
+	{
+		commands     = NULL;
+		sorted       = NULL;
+		count        = 0;
+		capacity     = 0;
+		text         = NULL;
+		textLength   = 0;
+		textCapacity = 0;
+		bandCounts   = NULL;
+		bandCapacity = 0;
+	}
+
+	~DrawList()
+	{
+		delete [] commands;
+		delete [] sorted;
+		delete [] text;
+		delete [] bandCounts;
+	}
+
+	/* Forgets all recorded commands, keeping the memory for the next frame. */
+	void Clear()
+	{
+		count      = 0;
+		textLength = 0;
+	}
+
+	/* The following record primitives in screen pixels. Lines and text do no clipping of their own, so the renderer
+	   must only record ones that fit in the buffer they will be drawn to. Circles that don't fit must be marked as
+	   Clipped, and are then checked pixel by pixel. */
+	void AddLine(int X0, int Y0, int X1, int Y1, unsigned long Colour)
+	{
+		DrawCommand &command = add(DrawCommand_Line, Colour);
+		command.X0 = X0;
+		command.Y0 = Y0;
+		command.X1 = X1;
+		command.Y1 = Y1;
+	}
+
+	void AddCircle(int X, int Y, float Radius, unsigned long Colour, bool Clipped = false)
+	{
+		DrawCommand &command = add(DrawCommand_Circle, Colour);
+		command.X0      = X;
+		command.Y0      = Y;
+		command.X1      = X;
+		command.Y1      = Y;
+		command.Radius  = Radius;
+		command.Clipped = Clipped;
+	}
+
+	/* The string is copied, so it doesn't need to stay around until the frame is drawn. */
+	void AddText(int X, int Y, const char *String, unsigned long Colour)
+	{
+		int length = (int)strlen(String) + 1;
+		if (textLength + length > textCapacity)
+		{
+			int   grown  = textCapacity > 0 ? textCapacity * 2 : 4096;
+			while (grown < textLength + length)
+				grown *= 2;
+			char *buffer = new char[grown];
+			if (textLength > 0)
+				memcpy(buffer, text, textLength);
+			delete [] text;
+			text         = buffer;
+			textCapacity = grown;
+		}
+
+		DrawCommand &command = add(DrawCommand_Text, Colour);
+		command.X0   = X;
+		command.Y0   = Y;
+		command.X1   = X + 6 * (length - 1);
+		command.Y1   = Y + 7;
+		command.Text = textLength;
+		memcpy(text + textLength, String, length);
+		textLength += length;
+	}
+
+	/* Orders the commands for drawing into a buffer Height rows high, see the class description. */
+	void Sort(int Height)
+	{
+		int bands = (Height + BandHeight - 1) / BandHeight + 1; /* The extra band at the end is for text. */
+		if (bands > bandCapacity)
+		{
+			delete [] bandCounts;
+			bandCounts   = new int[bands + 1];
+			bandCapacity = bands;
+		}
+		memset(bandCounts, 0, sizeof(int) * (bands + 1));
+
+		/* A counting sort: count the commands in each band, turn the counts into starting positions, then scatter. */
+		for (int index = 0; index < count; index++)
+			bandCounts[band(commands[index], bands) + 1]++;
+		for (int index = 1; index <= bands; index++)
+			bandCounts[index] += bandCounts[index - 1];
+		for (int index = 0; index < count; index++)
+			sorted[bandCounts[band(commands[index], bands)]++] = commands[index];
+
+		DrawCommand *swap = commands;
+		commands          = sorted;
+		sorted            = swap;
+	}
+
+	/* Draws every command into Buffer, which is Width by Height pixels with rows Stride pixels apart. */
+	void Rasterize(Pixel *Buffer, int Stride, int Width, int Height)
+	{
+		DrawArea all = {0, 0, Width, Height};
+		for (int index = 0; index < count; index++)
+		{
+			if (commands[index].Type == DrawCommand_Text)
+				rasterText(Buffer, Stride, commands[index]);
+			else
+				RasterizeShape(Buffer, Stride, all, commands[index]);
+		}
+	}
+
+	/* Draws a line or circle command, only touching the pixels inside Clip. Pixels are only checked one by one
+	   when the command doesn't fit inside Clip (or is marked Clipped), so this is safe to call from several threads
+	   at once, as long as each one has its own Clip. */
+	static void RasterizeShape(Pixel *Buffer, int Stride, const DrawArea &Clip, const DrawCommand &Command)
+	{
+		DrawArea area;
+		Bounds(Command, area);
+		bool fits = !Command.Clipped && area.Left >= Clip.Left && area.Top >= Clip.Top && area.Right <= Clip.Right && area.Bottom <= Clip.Bottom;
+
+		switch (Command.Type)
+		{
+			case DrawCommand_Line:   fits ? rasterLine<false>(Buffer, Stride, Clip, Command)   : rasterLine<true>(Buffer, Stride, Clip, Command);   break;
+			case DrawCommand_Circle: fits ? rasterCircle<false>(Buffer, Stride, Clip, Command) : rasterCircle<true>(Buffer, Stride, Clip, Command); break;
+			default:                 break;
+		}
+	}
+
+	/* Works out the pixels a command can touch. For lines and circles this errs on the side of a pixel too many. */
+	static void Bounds(const DrawCommand &Command, DrawArea &Result)
+	{
+		switch (Command.Type)
+		{
+			case DrawCommand_Line:
+				Result.Left   = (Command.X0 < Command.X1 ? Command.X0 : Command.X1) - 1;
+				Result.Top    = (Command.Y0 < Command.Y1 ? Command.Y0 : Command.Y1) - 1;
+				Result.Right  = (Command.X0 > Command.X1 ? Command.X0 : Command.X1) + 2;
+				Result.Bottom = (Command.Y0 > Command.Y1 ? Command.Y0 : Command.Y1) + 2;
+				break;
+			case DrawCommand_Circle:
+				Result.Left   = (int)(Command.X0 - Command.Radius) - 1;
+				Result.Top    = (int)(Command.Y0 - Command.Radius) - 1;
+				Result.Right  = (int)(Command.X0 + Command.Radius) + 2;
+				Result.Bottom = (int)(Command.Y0 + Command.Radius) + 2;
+				break;
+			default:
+				Result.Left   = Command.X0;
+				Result.Top    = Command.Y0;
+				Result.Right  = Command.X1;
+				Result.Bottom = Command.Y1;
+				break;
+		}
+	}
+
+	/* Draws a text command, these always cover the whole buffer. Not safe to call from more than one thread at a
+	   time, as it goes through the TextCache. */
+	void RasterizeText(Pixel *Buffer, int Stride, const DrawCommand &Command)
+	{
+		rasterText(Buffer, Stride, Command);
+	}
+
+	int Count()
+	{
+		return count;
+	}
+
+	const DrawCommand& Get(int Index)
+	{
+		return commands[Index];
+	}
+
+	/* Returns the string of a DrawCommand_Text command. */
+	const char* GetText(const DrawCommand &Command)
+	{
+		return text + Command.Text;
+	}
+
+	/* Prints every command, handy for seeing what a frame consists of. */
+	void Print(FILE *File)
+	{
+		for (int index = 0; index < count; index++)
+		{
+			const DrawCommand &command = commands[index];
+			switch (command.Type)
+			{
+				case DrawCommand_Line:   fprintf(File, "line   %d,%d %d,%d #%06lx\n", command.X0, command.Y0, command.X1, command.Y1, command.Colour); break;
+				case DrawCommand_Circle: fprintf(File, "circle %d,%d r%.1f #%06lx\n", command.X0, command.Y0, command.Radius, command.Colour); break;
+				case DrawCommand_Text:   fprintf(File, "text   %d,%d \"%s\" #%06lx\n", command.X0, command.Y0, text + command.Text, command.Colour); break;
+			}
+		}
+	}
+
+protected:
+	/* Which band a command is sorted into, text always going into the last one. */
+	static int band(const DrawCommand &Command, int Bands)
+	{
+		if (Command.Type == DrawCommand_Text)
+			return Bands - 1;
+
+		int result = top(Command) / BandHeight;
+		if (result < 0)
+			result = 0;
+		if (result > Bands - 2)
+			result = Bands - 2;
+		return result;
+	}
+};
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __EVALUATOR_H_
+#define __EVALUATOR_H_
+
+#include "bridge.h"
+#include "timer.h"
+
+/* If any loose pin drops further than this below where it was built, we consider the bridge collapsed,
+   even if no joint has actually snapped. Another "tweak until it feels right" value. */
+#define COLLAPSE_SAG 5.0f
+
+/* A scenario describes what we do to a bridge while testing it: how long we simulate for, and the load we drop on it.
+   Boxes are dropped one at a time above X = BoxX, every BoxInterval steps, starting at step 0. */
+struct Scenario
+{
+	int   Steps;       /* How many fixed steps to simulate. */
+	int   StepRate;    /* How many steps make up one second of simulated time. */
+	int   BoxCount;    /* How many debug boxes to drop onto the bridge. */
+	int   BoxInterval; /* How many steps to wait between box drops. */
+	float BoxMass;
+	float BoxX;
+	float BoxY;
+
+	Scenario()
+	{
+		Steps       = 600;
+		StepRate    = 60;
+		BoxCount    = 1;
+		BoxInterval = 60;
+		BoxMass     = 10.0f;
+		BoxX        = 0.0f;
+		BoxY        = 10.0f;
+	}
+};
+
+/* What came out of running a Scenario against a bridge. */
+struct Evaluation
+{
+	bool   Collapsed;    /* True if a joint broke, part of the bridge came away, or it sagged more than COLLAPSE_SAG. */
+	int    Steps;        /* How many steps were actually simulated. */
+	int    CollapseStep; /* The step during which part of the bridge first came away from every fixed pin, or -1. */
+	int    BrokenJoints;
+	float  MaxSag;       /* The furthest any loose pin dropped below its edit-time position during the run. */
+	double WallTime;     /* Real seconds it took to run the simulation, excluding building it. */
+	double StartTime;    /* Real seconds it took to build it, including letting it settle (see Bridge::SetPresettling()). */
+};
+
+/* This runs a bridge through a scenario as fast as the CPU allows, with no drawing and no frame timing.
+   It only needs a Bridge and its physics engine, so can be used on machines without a display. */
+class Evaluator
+{
+public:
+	static void Run(Bridge &Bridge, const Scenario &Scenario, Evaluation &Result)
+	{
+		float timeStep = Scenario.StepRate > 0 ? 1.0f / (float)Scenario.StepRate : 0.0f;
+		int   dropped  = 0;
+
+		Result.Collapsed    = false;
+		Result.Steps        = 0;
+		Result.CollapseStep = -1;
+		Result.BrokenJoints = 0;
+		Result.MaxSag       = 0.0f;
+
+		Timer timer;
+		Bridge.Start();
+		Result.StartTime = timer.Seconds();
+
+		timer.Reset();
+		for (int step = 0; step < Scenario.Steps; step++)
+		{
+			if (dropped < Scenario.BoxCount && (Scenario.BoxInterval <= 0 || step % Scenario.BoxInterval == 0))
+			{
+				Bridge.AddBox(Scenario.BoxX, Scenario.BoxY, Scenario.BoxMass);
+				dropped++;
+			}
+
+			Bridge.Simulate(timeStep);
+			Result.Steps++;
+			if (Result.CollapseStep < 0 && !Bridge.IsStanding())
+				Result.CollapseStep = step;
+
+			float sag = Bridge.MaxSag();
+			if (sag > Result.MaxSag)
+				Result.MaxSag = sag;
+		}
+		Result.WallTime = timer.Seconds();
+
+		Result.BrokenJoints = Bridge.BrokenJoints();
+		Result.Collapsed    = Result.BrokenJoints > 0 || Result.CollapseStep >= 0 || Result.MaxSag > COLLAPSE_SAG;
+
+		Bridge.Stop();
+	}
+};
+
+#endif
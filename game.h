@@ -13,19 +13,24 @@ Permission is granted to anyone to use this software for any purpose, including
 #define __GAME_H_
 
 #include <SDL/SDL.h>
-#include "renderer.h"
-#include "bridge.h"
+#include "renderer_sdl.h"
+#include "simulation_thread.h"
 
 enum
 {
-	ScreenWidth  = 800,
-	ScreenHeight = 600,
-	FrameRate    = 60,
+	ScreenWidth      = 800,
+	ScreenHeight     = 600,
+	FrameRate        = 60,
+	SimulationRate   = 60, /* How many fixed physics steps make up one second of simulated time. */
+	MaxStepsPerFrame = 15, /* If we fall further behind than this, we let simulated time slip rather than never catching up. */
 };
 
 /* This class is responsible for the running of the game.
    For now it's rather simple and not very well abstracted as it contains both calls to SDL creation and timing, but also game logic code.
-   It would probably be better for this to contain only game logic, calling abstracted class functions for input handling, timing, etc. */
+   It would probably be better for this to contain only game logic, calling abstracted class functions for input handling, timing, etc.
+
+   The bridge is simulated on a thread of its own (see SimulationThread), so this only handles input, which it passes
+   on as commands, and draws whatever the simulation published last. */
 class Game
 {
 protected:
@@ -37,11 +42,18 @@ protected:
 	Mode;
 
 protected:
-	Bridge   bridge;
-	Renderer renderer;
-	Mode     mode;
+	Bridge           bridge;
+	RendererSDL      renderer;
+	Mode             mode;
+	Timer            timer;
+	ThreadPool       threadPool;  /* Spare cores for the renderer to use, the simulation already has one of its own. */
+	SimulationThread simulation;
 
 public:
+	Game() : threadPool((int)std::thread::hardware_concurrency() - 2)
+	{
+	}
+
 	~Game()
 	{
 		Destroy();
@@ -54,12 +66,18 @@ public:
 
 		if (!bridge.Create())
 			return Destroy("Could not create bridge instance.");
+		bridge.SetStepBudget(0.25f / SimulationRate); /* Leave most of each step's worth of time for catching up. */
+		renderer.SetThreadPool(&threadPool);
 
 		/* The next two lines are for debugging, normally you'd load a bridge level here, and set to a building mode. */
 		bridge.CreateTestBridge();
 		bridge.SetEditMode(Bridge_EditMode_Car);
 
 		mode = Mode_Building;
+		timer.Reset();
+
+		/* From here on the bridge belongs to the simulation thread. */
+		simulation.Create(&bridge, &timer, SimulationRate, MaxStepsPerFrame);
 		return true;
 	}
 
@@ -67,6 +85,7 @@ public:
 	{
 		if (Message != NULL)
 			printf("Error starting game: %s\n", Message);
+		simulation.Destroy();
 		bridge.Destroy();
 		renderer.Destroy();
 		SDL_Quit();
@@ -89,29 +108,36 @@ public:
 					float x = event.button.x;
 					float y = event.button.y;
 					renderer.ToWorld(x, y);
-					bridge.HandleTouch(x, y);
+					simulation.Push(event.button.button == SDL_BUTTON_RIGHT ? SimulationCommand_Remove : SimulationCommand_Touch, x, y);
 					break;
 				}
 				case SDL_KEYDOWN:
 				{
 					switch (event.key.keysym.sym)
 					{
-						case SDLK_1:     bridge.SetEditMode(Bridge_EditMode_Structure); break;
-						case SDLK_2:     bridge.SetEditMode(Bridge_EditMode_Support); break;
-						case SDLK_3:     bridge.SetEditMode(Bridge_EditMode_Car); break;
-						case SDLK_t:     bridge.CreateTestBridge(); break;
-						case SDLK_r:     bridge.Create(); break;
+						case SDLK_1:     simulation.Push(SimulationCommand_EditMode, 0.0f, 0.0f, Bridge_EditMode_Structure); break;
+						case SDLK_2:     simulation.Push(SimulationCommand_EditMode, 0.0f, 0.0f, Bridge_EditMode_Support); break;
+						case SDLK_3:     simulation.Push(SimulationCommand_EditMode, 0.0f, 0.0f, Bridge_EditMode_Car); break;
+						case SDLK_t:     simulation.Push(SimulationCommand_TestBridge); break;
+						case SDLK_r:     simulation.Push(SimulationCommand_Reset); break;
+						case SDLK_e:
+						{
+							/* Swapping engines stops the simulation. */
+							mode = Mode_Building;
+							simulation.Push(SimulationCommand_SwapEngine);
+							break;
+						}
 						case SDLK_SPACE:
 						{
 							if (mode == Mode_Testing)
 							{
 								mode = Mode_Building;
-								bridge.Stop();
+								simulation.Push(SimulationCommand_Stop);
 							}
 							else
 							{
 								mode = Mode_Testing;
-								bridge.Start();
+								simulation.Push(SimulationCommand_Start);
 							}
 							break;
 						}
@@ -121,11 +147,22 @@ public:
 			}
 		}
 
+		/* The simulation runs fixed size steps to keep up with the timer, as per "Fix your timestep", and publishes the
+		   bridge after each lot. The latest one is drawn blended between its last two steps, going by how long ago
+		   the last one was due, so that movement stays smooth no matter how the two threads line up. */
+		const double    stepTime  = 1.0 / SimulationRate;
+		double          frameTime = timer.Seconds();
+		BridgeSnapshot &snapshot  = simulation.Latest();
+		float           alpha     = (float)((frameTime - snapshot.Time) / stepTime);
+
 		renderer.FrameStart();
-		bridge.Step(&renderer);
+		snapshot.Draw(&renderer, alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha));
 		renderer.FrameEnd();
 
-		SDL_Delay(1000 / FrameRate); /* This is disgusting and WRONG, internet read "How to fix your timestep" */
+		/* Give the rest of this frame's time back to the system instead of spinning. */
+		double remaining = (1.0 / FrameRate) - (timer.Seconds() - frameTime);
+		if (remaining > 0.0)
+			SDL_Delay((Uint32)(remaining * 1000.0));
 		return true;
 	}
 };
@@ -0,0 +1,73 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+/* This is a separate program to the game, it loads a bridge design and runs the simulation at full speed without
+   a window, SDL or a Renderer, then prints what happened. Handy for build servers and machines without a display.
+
+   Usage: headless [design file] [steps] [boxes] [box mass] [box2d|truss] [merge] [settle]
+   Without a design file, the built in test bridge is used. Use "-" as the design file for the test bridge when
+   giving further arguments. Giving "merge" welds straight runs of road together, see Bridge::SetRoadMerging().
+   Giving "settle" lets the bridge sag into place before the run starts, see Bridge::SetPresettling(), which is off
+   here otherwise as it would be paid for on every run. */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "evaluator.h"
+
+int main(int argc, char *argv[])
+{
+	Bridge     bridge;
+	Scenario   scenario;
+	Evaluation result;
+
+	if (argc > 1 && strcmp(argv[1], "-") != 0)
+	{
+		if (!bridge.Load(argv[1]))
+		{
+			printf("Could not load bridge design '%s', aborting...\n", argv[1]);
+			return -1;
+		}
+	}
+	else
+	{
+		bridge.CreateTestBridge();
+	}
+
+	if (argc > 2) scenario.Steps    = atoi(argv[2]);
+	if (argc > 3) scenario.BoxCount = atoi(argv[3]);
+	if (argc > 4) scenario.BoxMass  = (float)atof(argv[4]);
+	if (argc > 5 && strcmp(argv[5], "truss") == 0)
+		bridge.SetEngine(Bridge_Engine_Truss);
+	bridge.SetPresettling(false);
+	for (int index = 6; index < argc; index++)
+	{
+		if (strcmp(argv[index], "merge") == 0)
+			bridge.SetRoadMerging(true);
+		else if (strcmp(argv[index], "settle") == 0)
+			bridge.SetPresettling(true);
+	}
+
+	Evaluator::Run(bridge, scenario, result);
+
+	printf("outcome: %s\n",     result.Collapsed ? "collapsed" : "held");
+	printf("steps:   %d\n",     result.Steps);
+	printf("broken:  %d\n",     result.BrokenJoints);
+	if (result.CollapseStep >= 0)
+		printf("fell:    step %d\n", result.CollapseStep);
+	printf("sag:     %.3f\n",   result.MaxSag);
+	printf("wall:    %.6fs\n",  result.WallTime);
+	printf("start:   %.6fs\n",  result.StartTime);
+	if (result.WallTime > 0.0)
+		printf("rate:    %.0f steps/s\n", result.Steps / result.WallTime);
+
+	return result.Collapsed ? 1 : 0;
+}
@@ -12,8 +12,8 @@ Permission is granted to anyone to use this software for any purpose, including
 #ifndef __PHYSICS_H_
 #define __PHYSICS_H_
 
-#include <Box2D/Box2D.h>
-#include "positioning.h"
+#include "transform_store.h"
+#include "thread_pool.h"
 
 /* These are settings that need tweaking to get a good "feeling" bridge.
    The first two work together in deciding how bouncy and stiff the bridge is, which decides what the breaking force
@@ -22,252 +22,149 @@ Permission is granted to anyone to use this software for any purpose, including
 #define JOINT_FREQ      15.0f
 #define JOINT_DAMP      0.5f
 
+/* These are for engines working within a step budget (see Physics::SetStepBudget()). The first two are fractions of
+   the breaking force: above BUDGET_STRESSED the bridge is close to giving way, and below BUDGET_CALM nothing much is
+   happening. BUDGET_TUNNEL is how far something can move in one step before it might pass straight through a slab. */
+#define BUDGET_STRESSED 0.6f
+#define BUDGET_CALM     0.3f
+#define BUDGET_TUNNEL   0.25f
+
 enum
 {
-	Simulation_VelocityIterations = 8,
-	Simulation_PositionIterations = 3,
+	Simulation_VelocityIterations    = 8,
+	Simulation_PositionIterations    = 3,
+	Simulation_MinVelocityIterations = 3,    /* How far a step budget may take the iterations either way. */
+	Simulation_MaxVelocityIterations = 24,
+	Simulation_MinPositionIterations = 1,
+	Simulation_MaxPositionIterations = 8,
+	Simulation_ParallelJoints        = 2048, /* Below this many joints, it's quicker to read their forces on one thread. */
+	Simulation_JointChunk            = 256,  /* How many joints each thread reads at a time. */
+	Simulation_StateSize             = 8,    /* How many floats SaveState() writes per body. */
 };
 
-/* TODO: This should be a virtual base class exposing the Create, Destroy, Step and Add* functions so that
-   different physics engines can be pluggable.
+/* This is the base class for physics engines to derive from, e.g., PhysicsBox2D in physics_box2d.h, or
+   PhysicsTruss in physics_truss.h, meaning the Bridge doesn't care which one it is driving.
 
-   For now, this receives co-ordinates for new pins and slabs to be added, returning pointers to the newly
-   created physical bodies that result from the operation, as well as progressing the simulation through
-   the Step() function.
+   It receives co-ordinates for new pins and slabs to be added, returning handles to the newly created physical
+   bodies and joints that result from the operation, as well as progressing the simulation through the Step() function.
+   Handles are opaque, only the engine that handed one out knows what it means, and NULL is never a valid handle.
 
    Every time the main Bridge class swaps from edit to/from simulation mode, Destroy() and Create() of this
    class are called. */
 class Physics
 {
 protected:
-	/* These are the fixture.filter.categoryBits for the different types of bodies in the physical bridge scene.
-	   The car collides with slabs, likewise slabs collide with a car, but pins are basically a non-collidable entity. */
-	enum
-	{
-		Category_Car  = 1 << 1,
-		Category_Slab = 1 << 2,
-		Category_Pin  = 1 << 3,
-	};
-
-protected:
-	b2World *world;
+	ThreadPool *threadPool;    /* If set, the engine may spread its work over these threads. */
+	float       stepBudget;    /* How long each Step() should take in seconds, or zero to stick to fixed settings. */
 
 public:
 	Physics()
 	{
-		world = NULL;
+		threadPool = NULL;
+		stepBudget = 0.0f;
 	}
 
-	~Physics()
+	virtual ~Physics()
 	{
-		Destroy();
 	}
 
-	bool Create()
+	/* Optionally hands the physics engine some threads to spread work over, pass NULL to do everything on the calling thread. */
+	void SetThreadPool(ThreadPool *Pool)
 	{
-		Destroy();
-		/* Do some basic Box2D world setup stuff, setting gravity etc. */
-		b2Vec2 gravity;
-		gravity.Set(0.0f, -10.0f);
-		world = new b2World(gravity);
-		world->SetWarmStarting(true);
-		world->SetContinuousPhysics(true);
-		world->SetSubStepping(false);
-
-		return true;
+		threadPool = Pool;
 	}
 
-	bool Destroy()
+	/* Lets the engine trade accuracy for speed, trying to keep each Step() within Seconds of real time, while still
+	   being accurate when the bridge is close to breaking. Pass zero to go back to fixed settings. */
+	void SetStepBudget(float Seconds)
 	{
-		delete world;
-		world = NULL;
-
-		return false;
+		stepBudget = Seconds;
 	}
 
-	void Step(float TimeStep)
-	{
-		if (world == NULL)
-			return;
+	/* Throws away any existing world and starts an empty one. */
+	virtual bool Create() = 0;
 
-		world->Step(TimeStep, Simulation_VelocityIterations, Simulation_PositionIterations);
-	}
+	/* Throws away the world and everything in it, invalidating every handle handed out. */
+	virtual bool Destroy() = 0;
 
-	void RemoveJoint(void *Joint)
-	{
-		world->DestroyJoint((b2Joint*)Joint);
-	}
+	/* Advances the world by TimeStep seconds. */
+	virtual void Step(float TimeStep) = 0;
 
-	/* This takes a body that was returned from an AddPin or AddSlab call and sets up a
-	   transform instance with the current position and angle of the body. */
-	void GetTransform(void *Body, Positioning &Result)
-	{
-		/* If the simulation isn't running, return having not modified a thing. */
-		if (Body == NULL || world == NULL)
-			return;
+	/* Removes a joint returned by AddSupport. */
+	virtual void RemoveJoint(void *Joint) = 0;
 
-		b2Body *body = (b2Body*)Body;
-		const b2Transform &transform = body->GetTransform();
-		Result.Set(transform.p.x, transform.p.y, transform.q.GetAngle());
-	}
+	/* Removes a body returned by AddPin, AddStructure or AddBox from the running world, along with any joints still
+	   attached to it, leaving everything else as it is. */
+	virtual void RemoveBody(void *Body) = 0;
 
-	/* This takes a joint that was returned from an AddSupport call and calculates the force
-	   it is currently experiencing, destroying the joint if it exceeds the specified maximum.
-	   The calculated force is stored in Result so that the colour of the joint can be calculated. */
-	void HandleSupportForce(void *&Joint, float Delta, float &Result, float Maximum)
-	{
-		/* If the simulation isn't running, return having not modified a thing. */
-		if (Joint == NULL || world == NULL)
-			return;
-
-		b2Joint *joint = (b2Joint*)Joint;
-
-		Result = joint->GetReactionForce(Delta).Length();
-		if (Result >= Maximum)
-		{
-			Result = Maximum;
-			world->DestroyJoint(joint);
-			Joint = NULL;
-		}
-	}
+	/* Works out which of Bodies are still held together, through any number of live joints and other bodies. Groups[I]
+	   is set to a number that is the same for all the bodies held together with Bodies[I], and different for all the
+	   others, and Grounded[I] to whether any of them is fixed. NULL bodies get a group of -1. */
+	virtual void GetGroups(void **Bodies, int Count, int *Groups, bool *Grounded) = 0;
 
-	/* This takes a joint that was returned from an AddPin call and calculates the force
-	   it is currently experiencing, destroying the joint if it exceeds the specified maximum.
-	   (we separate this and the HandleSupportForce calls so that we can treat Pins and Supports differently). */
-	void HandlePinForce(void *Body, float Delta, float Maximum)
-	{
-		if (Body == NULL || world == NULL)
-			return;
+	/* Sets Debris[I] to whether Bodies[I] is no use to the simulation any more, returning how many are: those that
+	   have gone below Bottom, or left of Left or right of Right, and those that have come Loose[I] (e.g., from
+	   everything fixed, see GetGroups()) and come to rest. Loose can be NULL. NULL bodies and fixed ones never are. */
+	virtual int FindDebris(void **Bodies, int Count, float Left, float Right, float Bottom, const bool *Loose, bool *Debris) = 0;
 
-		Maximum *= Maximum; /* Square the maximum to save us having to compare sqrt's against it. */
+	/* This takes an array of bodies that were returned from AddPin, AddStructure or AddBox calls, and fills in the
+	   Result arrays with the current position and rotation of each one. Entries with a NULL body are left alone. */
+	virtual void GetTransforms(void **Bodies, int Count, TransformStore::Set &Result) = 0;
 
-		b2Body      *body  = (b2Body*)Body;
-		b2JointEdge *joint = body->GetJointList();
-		while (joint)
-		{
-			b2JointEdge *next = joint->next;
-			if (joint->joint->GetReactionForce(Delta).LengthSquared() > Maximum)
-				world->DestroyJoint(joint->joint);
+	/* Copies where each of Bodies is and how it's moving into State, Simulation_StateSize floats per body, so that
+	   LoadState() can put them back later, even in a new simulation of the same bridge. NULL bodies are skipped,
+	   leaving their floats alone. */
+	virtual void SaveState(void **Bodies, int Count, float *State) = 0;
 
-			joint = next;
-		}
-	}
+	/* Puts Bodies back where SaveState() found them, moving as they were then. The forces on the joints aren't part
+	   of it, the solver works those out again. */
+	virtual void LoadState(void **Bodies, int Count, const float *State) = 0;
 
-	/* This creates a circular body a the specified location and returns it. */
-	void* AddPin(float X, float Y, bool Fixed)
-	{
-		b2Body *result = NULL;
-
-		b2CircleShape shape;
-		shape.m_radius              = 0.5f;
-
-		b2FixtureDef  fixture;
-		fixture.shape               = &shape;
-		fixture.density             = 20.0f;
-		fixture.friction            = 0.2f;
-		fixture.filter.categoryBits = Category_Pin;
-		fixture.filter.maskBits     = 0; /* Pins don't collide with anything. */
-
-		b2BodyDef body;
-		if (!Fixed)
-			body.type = b2_dynamicBody;
-		body.position.Set(X, Y);
-		result = world->CreateBody(&body);
-		result->CreateFixture(&fixture);
-
-		return result;
-	}
+	/* This reads the force every joint is currently experiencing, then destroys every joint whose force is at or
+	   above Maximum, returning how many were destroyed. Delta is the step size, which the force is scaled by. */
+	virtual int HandleForces(float Delta, float Maximum) = 0;
 
-	/* This takes two Pin->PhysicsBody instances, converts them to native objects (in this case Box2D b2Body objects),
-	   then constructs a rectangle between them and hooks them up with rotation joints. */
-	void* AddStructure(void *Left, void *Right)
-	{
-		b2Body *result = NULL;
-		b2Body *left   = (b2Body*)Left;
-		b2Body *right  = (b2Body*)Right;
-
-		/* First get the X,Y positions of the two bodies... */
-		b2Vec2  leftPosition  = left->GetPosition();
-		b2Vec2  rightPosition = right->GetPosition();
-		/* ... then calculate the distance between them, this will be used for the length of the box ... */
-		b2Vec2  length        = leftPosition - rightPosition;
-		float   slabLength    = length.Length() / 2.0f; /* Box2D specifies a radius of sorts. */
-		/* ... calculate the center position of the rectangle, so we can use it as our object origin ... */
-		float   centerX       = leftPosition.x + ((rightPosition.x - leftPosition.x) / 2.0f);
-		float   centerY       = leftPosition.y + ((rightPosition.y - leftPosition.y) / 2.0f);
-		/* ... then work out the angle between the two Pins so we know the orientation of the rectangle. */
-		float   angle         = atan2(rightPosition.y - leftPosition.y, rightPosition.x - leftPosition.x);
-
-		/* Create a Box2D shape. */
-		b2PolygonShape shape;
-		shape.SetAsBox(slabLength, 0.125f);
-		/* Create a Box2D fixture set to the above shape, and set the collision index so that it is different to the car. */
-		b2FixtureDef fixture;
-		fixture.shape               = &shape;
-		fixture.density             = 20.0f;
-		fixture.friction            = 0.2f;
-		fixture.filter.categoryBits = Category_Slab;
-		fixture.filter.maskBits     = Category_Car;  /* Slabs do collide with the car. */
-		/* Create the Box2D body at the position and angle as calculated above. */
-		b2BodyDef body;
-		body.position.Set(centerX, centerY);
-		body.type  = b2_dynamicBody;
-		body.angle = angle;
-		result     = world->CreateBody(&body);
-		result->CreateFixture(&fixture);
-
-		/* Connect the slab to the two Pins it is attached to with a revolution joint. */
-		b2RevoluteJointDef joint;
-		joint.Initialize(left, result, leftPosition);
-		world->CreateJoint(&joint);
-		joint.Initialize(result, right, rightPosition);
-		world->CreateJoint(&joint);
-
-		return result;
-	}
+	/* This takes a joint that was returned from an AddSupport call and returns the force it experienced during the
+	   last HandleForces() call. If that call broke the joint, Joint is set to NULL. */
+	virtual float GetJointForce(void *&Joint) = 0;
+
+	/* Adds a pin at X,Y, which doesn't move at all if Fixed. */
+	virtual void* AddPin(float X, float Y, bool Fixed) = 0;
+
+	/* Adds a rigid slab between the two pins, returning its body. */
+	virtual void* AddStructure(void *Left, void *Right) = 0;
 
-	/* This takes two Pin->PhysicsBody instances, converts them to native objects (in this case Box2D b2Body objects),
-	   then constructs a distance joint between the two bodies. */
-	void* AddSupport(void *Left, void *Right)
+	/* Adds a rigid slab from X1,Y1 to X2,Y2 that isn't attached to anything, returning its body. */
+	virtual void* AddSlab(float X1, float Y1, float X2, float Y2) = 0;
+
+	/* Adds Count rigid slabs, the I'th from X1[I],Y1[I] to X2[I],Y2[I], welded together into a single body that is
+	   positioned and rotated like the first of them. Engines that gain nothing from this return NULL, in which case
+	   the slabs should be added one by one. */
+	virtual void* AddSlabs(const float * /*X1*/, const float * /*Y1*/, const float * /*X2*/, const float * /*Y2*/, int /*Count*/)
 	{
-		b2Body *left  = (b2Body*)Left;
-		b2Body *right = (b2Body*)Right;
-
-		/* Connect the support to the two pins it is attached to with a revolution joint */
-		b2DistanceJointDef joint;
-		joint.Initialize(left, right, left->GetPosition(), right->GetPosition());
-		joint.frequencyHz  = JOINT_FREQ;
-		joint.dampingRatio = JOINT_DAMP;
-		return world->CreateJoint(&joint);
+		return NULL;
 	}
 
-	/* This simply adds a debug box to our scene. */
-	void* AddBox(float X, float Y, float Mass)
+	/* Breaks a body returned by AddSlabs() back up into a body per slab, the I'th now going from X1[I],Y1[I] to
+	   X2[I],Y2[I], filling in Pieces with them. The joints on the welded body are moved to the nearest piece, but
+	   the pieces aren't joined to each other. */
+	virtual void Split(void * /*Body*/, const float * /*X1*/, const float * /*Y1*/, const float * /*X2*/, const float * /*Y2*/, int /*Count*/, void ** /*Pieces*/)
 	{
-		if (world == NULL)
-			return NULL;
-
-		b2PolygonShape shape;
-		shape.SetAsBox(1.0f, 1.0f);
-		/* Create a Box2D fixture set to the above shape, and set the collision index so that it is different to the car. */
-		b2FixtureDef fixture;
-		fixture.shape               = &shape;
-		fixture.density             = Mass;
-		fixture.friction            = 0.2f;
-		fixture.filter.categoryBits = Category_Car;
-		fixture.filter.maskBits     = Category_Slab | Category_Car;  /* Slabs do collide with the car. */
-		/* Create the Box2D body at the position and angle as calculated above. */
-		b2BodyDef  body;
-		b2Body    *result;
-
-		body.position.Set(X, Y);
-		body.type  = b2_dynamicBody;
-		result     = world->CreateBody(&body);
-		result->CreateFixture(&fixture);
-
-		return result;
 	}
 
+	/* Hinges two bodies together at X,Y with a breakable joint, returning the joint. This is how slabs are attached to
+	   pins, or straight to each other where there's no need for a pin body in between. */
+	virtual void* Join(void *First, void *Second, float X, float Y) = 0;
+
+	/* Returns the live joint made by Join() that hinges First and Second together nearest X,Y, or NULL if they aren't
+	   hinged together (any more). */
+	virtual void* FindJoint(void *First, void *Second, float X, float Y) = 0;
+
+	/* Adds a springy support between the two pins, returning its joint. */
+	virtual void* AddSupport(void *Left, void *Right) = 0;
+
+	/* This simply adds a debug box to our scene. */
+	virtual void* AddBox(float X, float Y, float Mass) = 0;
 };
 
 #endif
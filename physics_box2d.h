@@ -0,0 +1,699 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __PHYSICS_BOX2D_H_
+#define __PHYSICS_BOX2D_H_
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <Box2D/Box2D.h>
+#include "physics.h"
+
+/* The Box2D physics engine. Pins and structure slabs are rigid bodies, structure slabs are hooked up to their pins
+   with revolute joints, and supports are soft distance joints between two pins. */
+class PhysicsBox2D : public Physics
+{
+protected:
+	/* These are the fixture.filter.categoryBits for the different types of bodies in the physical bridge scene.
+	   The car collides with slabs, likewise slabs collide with a car, but pins are basically a non-collidable entity. */
+	enum
+	{
+		Category_Car  = 1 << 1,
+		Category_Slab = 1 << 2,
+		Category_Pin  = 1 << 3,
+	};
+
+protected:
+	b2World    *world;
+
+	/* Every joint we create is given a slot in these arrays, its index being kept in the joint's user data.
+	   HandleForces() reads the force on each joint into the forces array in one sweep, and destroyed joints leave
+	   their slot NULL until the next Create(). */
+	b2Joint   **joints;
+	float      *forces;
+	int         jointCount;
+	int         jointCapacity;
+	float       forceDelta;    /* The Delta passed to HandleForces(), for the force reading task. */
+
+	/* The joints destroyed during the last HandleForces() call, sorted by address so that GetJointForce can tell a
+	   handle to a broken joint apart from a live one without touching the freed joint. */
+	b2Joint   **broken;
+	int         brokenCount;
+
+	/* What the step budget controller (see adapt()) has to work with. */
+	int         velocityIterations;
+	int         positionIterations;
+	float       stress;        /* The biggest joint force during the last HandleForces(), as a fraction of Maximum. */
+	b2Body    **boxes;         /* The debug boxes, which are the only fast movers worth continuous collision. */
+	int         boxCount;
+	int         boxCapacity;
+
+	/* For GetGroups(), which labels each body with its group in its user data. */
+	b2Body    **queue;
+	bool       *groundedGroups;
+	int         queueCapacity;
+	intptr_t    labels;        /* The last label handed out, so labels from earlier calls are all lower. */
+
+	static int comparePointers(const void *Left, const void *Right)
+	{
+		uintptr_t left  = (uintptr_t)*(void* const*)Left;
+		uintptr_t right = (uintptr_t)*(void* const*)Right;
+		return left < right ? -1 : (left > right ? 1 : 0);
+	}
+
+	/* This reads the force on joints Begin..End-1. It only reads from the world, so can safely run on several threads at once. */
+	static void measureForces(void *Context, int Begin, int End)
+	{
+		PhysicsBox2D *physics = (PhysicsBox2D*)Context;
+		for (int index = Begin; index < End; index++)
+		{
+			b2Joint *joint = physics->joints[index];
+			physics->forces[index] = joint != NULL ? joint->GetReactionForce(physics->forceDelta).Length() : 0.0f;
+		}
+	}
+
+	/* Creates a joint and hands it a slot in the joints/forces arrays. */
+	b2Joint* createJoint(b2JointDef &Definition)
+	{
+		if (jointCount == jointCapacity)
+		{
+			int       capacity = jointCapacity > 0 ? jointCapacity * 2 : 1024;
+			b2Joint **grown    = new b2Joint*[capacity];
+			if (jointCount > 0)
+				memcpy(grown, joints, sizeof(b2Joint*) * jointCount);
+			delete [] joints;
+			delete [] forces;
+			delete [] broken;
+			joints        = grown;
+			forces        = new float[capacity];
+			broken        = new b2Joint*[capacity];
+			jointCapacity = capacity;
+		}
+
+		Definition.userData = (void*)(intptr_t)jointCount;
+		joints[jointCount]  = world->CreateJoint(&Definition);
+		forces[jointCount]  = 0.0f;
+		return joints[jointCount++];
+	}
+
+	/* Gives a slab body its box, and sets the collision index so that it is different to the car. */
+	void addSlabFixture(b2Body *Body, const b2PolygonShape &Shape)
+	{
+		b2FixtureDef fixture;
+		fixture.shape               = &Shape;
+		fixture.density             = 20.0f;
+		fixture.friction            = 0.2f;
+		fixture.filter.categoryBits = Category_Slab;
+		fixture.filter.maskBits     = Category_Car;  /* Slabs do collide with the car. */
+		Body->CreateFixture(&fixture);
+	}
+
+	void destroyJoint(b2Joint *Joint)
+	{
+		joints[(intptr_t)Joint->GetUserData()] = NULL;
+		world->DestroyJoint(Joint);
+	}
+
+	/* Tunes the solver for the next step, going by how long the last one took and how close the bridge is to breaking:
+	   - A stressed bridge (over BUDGET_STRESSED) gets more iterations while there's time to spare, and never fewer
+	     than the defaults, as that's exactly when accuracy matters.
+	   - Otherwise, going over budget, or being calm (under BUDGET_CALM) with time to spare, costs iterations.
+	   Continuous collision (Box2D's TOI solver) is only switched on while a box is moving fast enough to pass through
+	   a slab in one step, and only those boxes are made bullets, as they're the ones that would tunnel through the
+	   (dynamic) slabs. */
+	void adapt(float TimeStep)
+	{
+		float spent    = world->GetProfile().step / 1000.0f;
+		bool  over     = spent > stepBudget;
+		bool  stressed = stress >= BUDGET_STRESSED;
+		bool  calm     = stress <  BUDGET_CALM;
+
+		/* Straight back up to the defaults, even over budget, rather than climbing back one at a time from a calm spell. */
+		if (stressed)
+		{
+			velocityIterations = velocityIterations > Simulation_VelocityIterations ? velocityIterations : Simulation_VelocityIterations;
+			positionIterations = positionIterations > Simulation_PositionIterations ? positionIterations : Simulation_PositionIterations;
+		}
+
+		if (stressed && !over)
+		{
+			velocityIterations += velocityIterations < Simulation_MaxVelocityIterations ? 1 : 0;
+			positionIterations += positionIterations < Simulation_MaxPositionIterations ? 1 : 0;
+		}
+		else if (over || (calm && spent < stepBudget / 2.0f))
+		{
+			int velocityFloor = stressed ? Simulation_VelocityIterations : Simulation_MinVelocityIterations;
+			int positionFloor = stressed ? Simulation_PositionIterations : Simulation_MinPositionIterations;
+			velocityIterations -= velocityIterations > velocityFloor ? 1 : 0;
+			positionIterations -= positionIterations > positionFloor ? 1 : 0;
+		}
+
+		bool fast = false;
+		for (int index = 0; index < boxCount; index++)
+		{
+			bool bullet = boxes[index]->GetLinearVelocity().Length() * TimeStep > BUDGET_TUNNEL;
+			boxes[index]->SetBullet(bullet);
+			fast = fast || bullet;
+		}
+		world->SetContinuousPhysics(fast);
+	}
+
+public:
+	PhysicsBox2D()
+	{
+		world         = NULL;
+		joints        = NULL;
+		forces        = NULL;
+		broken        = NULL;
+		jointCount    = 0;
+		jointCapacity = 0;
+		brokenCount   = 0;
+		boxes         = NULL;
+		boxCount      = 0;
+		boxCapacity   = 0;
+		queue          = NULL;
+		groundedGroups = NULL;
+		queueCapacity  = 0;
+		labels         = 0;
+		stress        = 0.0f;
+	}
+
+	~PhysicsBox2D()
+	{
+		Destroy();
+		delete [] joints;
+		delete [] forces;
+		delete [] broken;
+		delete [] boxes;
+		delete [] queue;
+		delete [] groundedGroups;
+	}
+
+	/* Each simulation gets a world of its own. Box2D (2.2) has no way to hand it an allocator of ours, b2Alloc being
+	   built into the library, and emptying out a kept world body by body costs more than deleting it, which frees the
+	   chunks of its block allocator in one go. Our own joint arrays do keep their memory from one simulation to the next. */
+	bool Create()
+	{
+		Destroy();
+		/* Do some basic Box2D world setup stuff, setting gravity etc. */
+		b2Vec2 gravity;
+		gravity.Set(0.0f, -10.0f);
+		world = new b2World(gravity);
+		world->SetWarmStarting(true);
+		world->SetContinuousPhysics(true);
+		world->SetSubStepping(false);
+
+		velocityIterations = Simulation_VelocityIterations;
+		positionIterations = Simulation_PositionIterations;
+		stress             = 0.0f;
+		return true;
+	}
+
+	bool Destroy()
+	{
+		delete world;
+		world       = NULL;
+		jointCount  = 0;
+		brokenCount = 0;
+		boxCount    = 0;
+
+		return false;
+	}
+
+	void Step(float TimeStep)
+	{
+		if (world == NULL)
+			return;
+
+		world->Step(TimeStep, velocityIterations, positionIterations);
+		if (stepBudget > 0.0f)
+			adapt(TimeStep);
+	}
+
+	/* The bodies either side are woken up, otherwise a sleeping bridge would stay hanging in the air. */
+	void RemoveJoint(void *Joint)
+	{
+		b2Joint *joint = (b2Joint*)Joint;
+		joint->GetBodyA()->SetAwake(true);
+		joint->GetBodyB()->SetAwake(true);
+		destroyJoint(joint);
+	}
+
+	void RemoveBody(void *Body)
+	{
+		/* Box2D destroys the joints on the body along with it, so their slots have to be emptied here. */
+		b2Body *body = (b2Body*)Body;
+		for (b2JointEdge *edge = body->GetJointList(); edge != NULL; edge = edge->next)
+		{
+			edge->other->SetAwake(true);
+			joints[(intptr_t)edge->joint->GetUserData()] = NULL;
+		}
+		for (int index = boxCount - 1; index >= 0; index--)
+		{
+			if (boxes[index] == body)
+				boxes[index] = boxes[--boxCount];
+		}
+		world->DestroyBody(body);
+	}
+
+	/* Each group of bodies is found by walking the joints out from the first body not yet labelled, labelling every
+	   body reached along the way. The labels carry on from those of the last call, so nothing needs clearing. */
+	void GetGroups(void **Bodies, int Count, int *Groups, bool *Grounded)
+	{
+		if (world == NULL)
+		{
+			for (int index = 0; index < Count; index++)
+			{
+				Groups[index]   = -1;
+				Grounded[index] = false;
+			}
+			return;
+		}
+
+		if (queueCapacity < world->GetBodyCount())
+		{
+			delete [] queue;
+			delete [] groundedGroups;
+			queueCapacity  = world->GetBodyCount() * 2;
+			queue          = new b2Body*[queueCapacity];
+			groundedGroups = new bool[queueCapacity];
+		}
+
+		intptr_t first = labels + 1;
+		for (b2Body *body = world->GetBodyList(); body != NULL; body = body->GetNext())
+		{
+			if ((intptr_t)body->GetUserData() >= first)
+				continue;
+
+			intptr_t label    = ++labels;
+			bool     grounded = false;
+			int      head     = 0;
+			int      tail     = 0;
+			body->SetUserData((void*)label);
+			queue[tail++] = body;
+			while (head < tail)
+			{
+				b2Body *current = queue[head++];
+				grounded = grounded || current->GetType() == b2_staticBody;
+				for (b2JointEdge *edge = current->GetJointList(); edge != NULL; edge = edge->next)
+				{
+					if ((intptr_t)edge->other->GetUserData() != label)
+					{
+						edge->other->SetUserData((void*)label);
+						queue[tail++] = edge->other;
+					}
+				}
+			}
+			groundedGroups[label - first] = grounded;
+		}
+
+		for (int index = 0; index < Count; index++)
+		{
+			b2Body *body    = (b2Body*)Bodies[index];
+			int     group   = body != NULL ? (int)((intptr_t)body->GetUserData() - first) : -1;
+			Groups[index]   = group;
+			Grounded[index] = group >= 0 && groundedGroups[group];
+		}
+	}
+
+	/* Box2D already puts bodies to sleep once they stop moving, so that is what at rest means here. */
+	int FindDebris(void **Bodies, int Count, float Left, float Right, float Bottom, const bool *Loose, bool *Debris)
+	{
+		memset(Debris, 0, sizeof(bool) * Count);
+		if (world == NULL)
+			return 0;
+
+		int result = 0;
+		for (int index = 0; index < Count; index++)
+		{
+			b2Body *body = (b2Body*)Bodies[index];
+			if (body == NULL || body->GetType() == b2_staticBody)
+				continue;
+
+			const b2Vec2 &position = body->GetPosition();
+			Debris[index] = position.y < Bottom || position.x < Left || position.x > Right ||
+			                (Loose != NULL && Loose[index] && !body->IsAwake());
+			result += Debris[index] ? 1 : 0;
+		}
+		return result;
+	}
+
+	/* This takes an array of bodies that were returned from AddPin, AddStructure or AddBox calls, and fills in the
+	   Result arrays with the current position and rotation of each one. Entries with a NULL body are left alone. */
+	void GetTransforms(void **Bodies, int Count, TransformStore::Set &Result)
+	{
+		/* If the simulation isn't running, return having not modified a thing. */
+		if (world == NULL)
+			return;
+
+		for (int index = 0; index < Count; index++)
+		{
+			b2Body *body = (b2Body*)Bodies[index];
+			if (body == NULL)
+				continue;
+
+			const b2Transform &transform = body->GetTransform();
+			Result.X[index]      = transform.p.x;
+			Result.Y[index]      = transform.p.y;
+			Result.Cosine[index] = transform.q.c;
+			Result.Sine[index]   = transform.q.s;
+		}
+	}
+
+	/* Each body's state is its position, angle, and linear and angular velocity. Box2D 2.2 has no way to set the
+	   impulses joints are warm started with, so those start from nothing and take the first step or two to build up. */
+	void SaveState(void **Bodies, int Count, float *State)
+	{
+		if (world == NULL)
+			return;
+
+		for (int index = 0; index < Count; index++, State += Simulation_StateSize)
+		{
+			b2Body *body = (b2Body*)Bodies[index];
+			if (body == NULL)
+				continue;
+
+			State[0] = body->GetPosition().x;
+			State[1] = body->GetPosition().y;
+			State[2] = body->GetAngle();
+			State[3] = body->GetLinearVelocity().x;
+			State[4] = body->GetLinearVelocity().y;
+			State[5] = body->GetAngularVelocity();
+		}
+	}
+
+	void LoadState(void **Bodies, int Count, const float *State)
+	{
+		if (world == NULL)
+			return;
+
+		for (int index = 0; index < Count; index++, State += Simulation_StateSize)
+		{
+			b2Body *body = (b2Body*)Bodies[index];
+			if (body == NULL)
+				continue;
+
+			body->SetTransform(b2Vec2(State[0], State[1]), State[2]);
+			body->SetLinearVelocity(b2Vec2(State[3], State[4]));
+			body->SetAngularVelocity(State[5]);
+		}
+	}
+
+	/* This reads the force every joint is currently experiencing in one sweep, on several threads if there are
+	   enough joints and a pool was given, then destroys every joint whose force is at or above Maximum.
+	   The joints are only destroyed once all the forces have been read, so the result doesn't depend on the order
+	   joints are checked in. Returns the number of joints that were destroyed. */
+	int HandleForces(float Delta, float Maximum)
+	{
+		brokenCount = 0;
+		if (world == NULL)
+			return brokenCount;
+
+		forceDelta = Delta;
+		if (threadPool != NULL && jointCount >= Simulation_ParallelJoints)
+			threadPool->Run(measureForces, this, jointCount, Simulation_JointChunk);
+		else
+			measureForces(this, 0, jointCount);
+
+		/* Queue up the joints that are over the limit... */
+		float biggest = 0.0f;
+		for (int index = 0; index < jointCount; index++)
+		{
+			if (joints[index] == NULL)
+				continue;
+			if (forces[index] >= Maximum)
+				broken[brokenCount++] = joints[index];
+			if (forces[index] > biggest)
+				biggest = forces[index];
+		}
+		stress = Maximum > 0.0f ? biggest / Maximum : 0.0f;
+
+		/* ... then break them. */
+		for (int index = 0; index < brokenCount; index++)
+			destroyJoint(broken[index]);
+
+		if (brokenCount > 1)
+			qsort(broken, brokenCount, sizeof(b2Joint*), comparePointers);
+		return brokenCount;
+	}
+
+	/* This takes a joint that was returned from an AddSupport call and returns the force it experienced during the
+	   last HandleForces() call. If that call broke the joint, Joint is set to NULL. */
+	float GetJointForce(void *&Joint)
+	{
+		/* If the simulation isn't running, return having not modified a thing. */
+		if (Joint == NULL || world == NULL)
+			return 0.0f;
+
+		if (brokenCount > 0 && bsearch(&Joint, broken, brokenCount, sizeof(b2Joint*), comparePointers) != NULL)
+		{
+			Joint = NULL;
+			return 0.0f;
+		}
+
+		return forces[(intptr_t)((b2Joint*)Joint)->GetUserData()];
+	}
+
+	/* This creates a circular body a the specified location and returns it. */
+	void* AddPin(float X, float Y, bool Fixed)
+	{
+		b2Body *result = NULL;
+
+		b2CircleShape shape;
+		shape.m_radius              = 0.5f;
+
+		b2FixtureDef  fixture;
+		fixture.shape               = &shape;
+		fixture.density             = 20.0f;
+		fixture.friction            = 0.2f;
+		fixture.filter.categoryBits = Category_Pin;
+		fixture.filter.maskBits     = 0; /* Pins don't collide with anything. */
+
+		b2BodyDef body;
+		if (!Fixed)
+			body.type = b2_dynamicBody;
+		body.position.Set(X, Y);
+		result = world->CreateBody(&body);
+		result->CreateFixture(&fixture);
+
+		return result;
+	}
+
+	/* Every joint on a body is on its joint list, so only those of First need looking at. */
+	void* FindJoint(void *First, void *Second, float X, float Y)
+	{
+		b2Joint *result = NULL;
+		float    best   = FLT_MAX;
+		for (b2JointEdge *edge = ((b2Body*)First)->GetJointList(); edge != NULL; edge = edge->next)
+		{
+			if (edge->other != (b2Body*)Second || edge->joint->GetType() != e_revoluteJoint)
+				continue;
+
+			b2Vec2 anchor = edge->joint->GetAnchorA();
+			float  away   = (anchor.x - X) * (anchor.x - X) + (anchor.y - Y) * (anchor.y - Y);
+			if (away < best)
+			{
+				best   = away;
+				result = edge->joint;
+			}
+		}
+		return result;
+	}
+
+	/* This takes two Pin->PhysicsBody instances, converts them to native objects (in this case Box2D b2Body objects),
+	   then constructs a rectangle between them and hooks them up with rotation joints. */
+	void* AddStructure(void *Left, void *Right)
+	{
+		b2Vec2  leftPosition  = ((b2Body*)Left)->GetPosition();
+		b2Vec2  rightPosition = ((b2Body*)Right)->GetPosition();
+		void   *result        = AddSlab(leftPosition.x, leftPosition.y, rightPosition.x, rightPosition.y);
+
+		/* Connect the slab to the two Pins it is attached to with a revolution joint. */
+		Join(Left, result, leftPosition.x, leftPosition.y);
+		Join(result, Right, rightPosition.x, rightPosition.y);
+
+		return result;
+	}
+
+	/* This constructs a rectangle from X1,Y1 to X2,Y2, that is attached to nothing. */
+	void* AddSlab(float X1, float Y1, float X2, float Y2)
+	{
+		b2Body *result = NULL;
+
+		/* First get the X,Y positions of the two ends... */
+		b2Vec2  leftPosition(X1, Y1);
+		b2Vec2  rightPosition(X2, Y2);
+		/* ... then calculate the distance between them, this will be used for the length of the box ... */
+		b2Vec2  length        = leftPosition - rightPosition;
+		float   slabLength    = length.Length() / 2.0f; /* Box2D specifies a radius of sorts. */
+		/* ... calculate the center position of the rectangle, so we can use it as our object origin ... */
+		float   centerX       = leftPosition.x + ((rightPosition.x - leftPosition.x) / 2.0f);
+		float   centerY       = leftPosition.y + ((rightPosition.y - leftPosition.y) / 2.0f);
+		/* ... then work out the angle between the two Pins so we know the orientation of the rectangle. */
+		float   angle         = atan2(rightPosition.y - leftPosition.y, rightPosition.x - leftPosition.x);
+
+		/* Create a Box2D shape. */
+		b2PolygonShape shape;
+		shape.SetAsBox(slabLength, 0.125f);
+		/* Create the Box2D body at the position and angle as calculated above. */
+		b2BodyDef body;
+		body.position.Set(centerX, centerY);
+		body.type  = b2_dynamicBody;
+		body.angle = angle;
+		result     = world->CreateBody(&body);
+		addSlabFixture(result, shape);
+
+		return result;
+	}
+
+	/* One body with a box fixture per slab, placed relative to the first slab, which the body is positioned at.
+	   The car then only has one body to check against for the whole run, rather than one per slab. */
+	void* AddSlabs(const float *X1, const float *Y1, const float *X2, const float *Y2, int Count)
+	{
+		float originX = (X1[0] + X2[0]) / 2.0f;
+		float originY = (Y1[0] + Y2[0]) / 2.0f;
+		float angle   = atan2(Y2[0] - Y1[0], X2[0] - X1[0]);
+		float cosine  = cos(angle);
+		float sine    = sin(angle);
+
+		b2BodyDef body;
+		body.position.Set(originX, originY);
+		body.type  = b2_dynamicBody;
+		body.angle = angle;
+		b2Body *result = world->CreateBody(&body);
+
+		for (int index = 0; index < Count; index++)
+		{
+			/* Turn the middle of each slab into co-ordinates relative to the body. */
+			float deltaX = X2[index] - X1[index];
+			float deltaY = Y2[index] - Y1[index];
+			float awayX  = X1[index] + deltaX / 2.0f - originX;
+			float awayY  = Y1[index] + deltaY / 2.0f - originY;
+
+			b2PolygonShape shape;
+			shape.SetAsBox(sqrtf(deltaX * deltaX + deltaY * deltaY) / 2.0f, 0.125f, b2Vec2(awayX * cosine + awayY * sine, awayY * cosine - awayX * sine), atan2(deltaY, deltaX) - angle);
+			addSlabFixture(result, shape);
+		}
+
+		return result;
+	}
+
+	/* Makes a separate slab for each piece, carrying on with the velocity its part of the welded body had. Box2D can't
+	   move a joint over to another body, so the joints on the welded body are made again on whichever piece is
+	   nearest to them. */
+	void Split(void *Body, const float *X1, const float *Y1, const float *X2, const float *Y2, int Count, void **Pieces)
+	{
+		b2Body *body = (b2Body*)Body;
+		for (int index = 0; index < Count; index++)
+		{
+			b2Body *piece = (b2Body*)AddSlab(X1[index], Y1[index], X2[index], Y2[index]);
+			piece->SetLinearVelocity(body->GetLinearVelocityFromWorldPoint(piece->GetWorldCenter()));
+			piece->SetAngularVelocity(body->GetAngularVelocity());
+			Pieces[index] = piece;
+		}
+
+		b2JointEdge *edge;
+		while ((edge = body->GetJointList()) != NULL)
+		{
+			b2Body *other  = edge->other;
+			b2Vec2  anchor = edge->joint->GetAnchorA();
+			destroyJoint(edge->joint);
+
+			int   nearest = 0;
+			float best    = FLT_MAX;
+			for (int index = 0; index < Count; index++)
+			{
+				float deltaX = X2[index] - X1[index];
+				float deltaY = Y2[index] - Y1[index];
+				float span   = deltaX * deltaX + deltaY * deltaY;
+				float along  = span > 0.0f ? ((anchor.x - X1[index]) * deltaX + (anchor.y - Y1[index]) * deltaY) / span : 0.0f;
+				along        = along < 0.0f ? 0.0f : (along > 1.0f ? 1.0f : along);
+				float awayX  = anchor.x - (X1[index] + deltaX * along);
+				float awayY  = anchor.y - (Y1[index] + deltaY * along);
+				if (awayX * awayX + awayY * awayY < best)
+				{
+					best    = awayX * awayX + awayY * awayY;
+					nearest = index;
+				}
+			}
+			Join(other, Pieces[nearest], anchor.x, anchor.y);
+		}
+
+		world->DestroyBody(body);
+	}
+
+	/* Connects two bodies with a revolution joint at X,Y. */
+	void* Join(void *First, void *Second, float X, float Y)
+	{
+		b2RevoluteJointDef joint;
+		joint.Initialize((b2Body*)First, (b2Body*)Second, b2Vec2(X, Y));
+		return createJoint(joint);
+	}
+
+	/* This takes two Pin->PhysicsBody instances, converts them to native objects (in this case Box2D b2Body objects),
+	   then constructs a distance joint between the two bodies. */
+	void* AddSupport(void *Left, void *Right)
+	{
+		b2Body *left  = (b2Body*)Left;
+		b2Body *right = (b2Body*)Right;
+
+		/* Connect the support to the two pins it is attached to with a revolution joint */
+		b2DistanceJointDef joint;
+		joint.Initialize(left, right, left->GetPosition(), right->GetPosition());
+		joint.frequencyHz  = JOINT_FREQ;
+		joint.dampingRatio = JOINT_DAMP;
+		return createJoint(joint);
+	}
+
+	/* This simply adds a debug box to our scene. */
+	void* AddBox(float X, float Y, float Mass)
+	{
+		if (world == NULL)
+			return NULL;
+
+		b2PolygonShape shape;
+		shape.SetAsBox(1.0f, 1.0f);
+		/* Create a Box2D fixture set to the above shape, and set the collision index so that it is different to the car. */
+		b2FixtureDef fixture;
+		fixture.shape               = &shape;
+		fixture.density             = Mass;
+		fixture.friction            = 0.2f;
+		fixture.filter.categoryBits = Category_Car;
+		fixture.filter.maskBits     = Category_Slab | Category_Car;  /* Slabs do collide with the car. */
+		/* Create the Box2D body at the position and angle as calculated above. */
+		b2BodyDef  body;
+		b2Body    *result;
+
+		body.position.Set(X, Y);
+		body.type  = b2_dynamicBody;
+		result     = world->CreateBody(&body);
+		result->CreateFixture(&fixture);
+
+		if (boxCount == boxCapacity)
+		{
+			int      capacity = boxCapacity > 0 ? boxCapacity * 2 : 64;
+			b2Body **grown    = new b2Body*[capacity];
+			if (boxCount > 0)
+				memcpy(grown, boxes, sizeof(b2Body*) * boxCount);
+			delete [] boxes;
+			boxes       = grown;
+			boxCapacity = capacity;
+		}
+		boxes[boxCount++] = result;
+
+		return result;
+	}
+
+};
+
+#endif
@@ -0,0 +1,1002 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __PHYSICS_TRUSS_H_
+#define __PHYSICS_TRUSS_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "physics.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PHYSICS_TRUSS_SSE2
+#include <emmintrin.h>
+#endif
+
+/* The masses here are worked out the same way Box2D would from the shapes and densities in physics_box2d.h, so that
+   both engines make bridges of about the same weight, and BREAK_AT_FORCE means roughly the same thing in both. */
+#define TRUSS_GRAVITY       -10.0f
+#define TRUSS_DENSITY        20.0f
+#define TRUSS_PIN_MASS      (TRUSS_DENSITY * 3.14159265f * 0.5f * 0.5f)
+#define TRUSS_SLAB_HEIGHT    0.25f
+#define TRUSS_BOX_RADIUS     1.0f
+#define TRUSS_FRICTION       0.2f
+#define TRUSS_PIN_FREQ       60.0f /* How stiff the pinning of structure slabs to their pins is, see spring(). */
+#define TRUSS_PIN_DAMP       1.0f
+#define TRUSS_REST           0.05f /* Particles slower than this count as at rest, see FindDebris(). */
+
+enum
+{
+	Truss_Substeps = 10, /* Every Step() is split into this many small steps, each solving every constraint once. */
+	Truss_Colours  = 64, /* How many groups of independent constraints there can be, see colour(). */
+};
+
+/* A physics engine written for what bridges actually are: point masses joined by rods and springs.
+
+   Pins are particles, supports are springy distance constraints between two pins, and structure slabs are a
+   particle at each end held apart by a rigid rod, each end being pinned to its pin by a breakable zero-length
+   constraint (just like the revolute joints in the Box2D version). Debug boxes are heavy round particles that
+   collide with structure slabs and each other, they don't rotate.
+
+   It's solved with extended position based dynamics (XPBD), using lots of small steps with a single pass over the
+   constraints each, which is stable for stiff trusses without needing many iterations. Springs get their stiffness
+   and damping from JOINT_FREQ and JOINT_DAMP, as in Box2D.
+
+   Everything is stored as structures of arrays. Moving the particles is done four at a time with SSE2 where
+   available. The constraints are sorted into "colours" where no two constraints of the same colour share a
+   particle, so each colour is solved four constraints at a time, and spread over the thread pool when it's big.
+
+   Handles are indices plus one: bodies index the bodies arrays, and joints index the constraint arrays. */
+class PhysicsTruss : public Physics
+{
+protected:
+	enum
+	{
+		Constraint_Alive = 1 << 0,
+		Constraint_Joint = 1 << 1, /* Breakable, and has its force reported. */
+	};
+
+	/* The particles. */
+	float         *x;
+	float         *y;
+	float         *previousX;
+	float         *previousY;
+	float         *velocityX;
+	float         *velocityY;
+	float         *inverseMass;
+	int            particleCount;
+	int            particleCapacity;
+
+	/* The bodies handed out, being either a single particle (second is -1), or the two ends of a slab. */
+	int           *bodyFirst;
+	int           *bodySecond;
+	int            bodyCount;
+	int            bodyCapacity;
+
+	/* The constraints, each trying to keep its two particles Length apart. */
+	int           *constraintA;
+	int           *constraintB;
+	float         *length;
+	float         *compliance;  /* The inverse of the stiffness, zero being completely rigid. */
+	float         *damping;
+	float         *impulseX;    /* Summed over the last Step(). As a vector, as the pinning constraints have no */
+	float         *impulseY;    /* fixed direction. */
+	float         *force;       /* Worked out by HandleForces(). */
+	unsigned char *state;
+	int            constraintCount;
+	int            constraintCapacity;
+
+	/* The live constraints sorted by colour, each colour starting at colourStart[colour] in order.
+	   The last colour holds whatever didn't fit in the others, and is solved one at a time. */
+	int           *order;
+	int           *sorted;      /* Scratch space for colour(). */
+	int            colourStart[Truss_Colours + 1];
+	uint64_t      *usedColours; /* Per particle, while colouring. */
+	int           *group;       /* Per particle, while GetGroups() works out what's joined to what. */
+	bool          *grounded;
+	bool           dirty;       /* Constraints were added or removed since the last colour(). */
+
+	/* What can collide: boxes are particles, slabs are their rod constraints. */
+	int           *boxes;
+	int            boxCount;
+	int            boxCapacity;
+	int           *rods;
+	int            rodCount;
+	int            rodCapacity;
+
+	bool           created;
+	float          solveStep;   /* The sub-step being solved, for solveChunk(). */
+	int            solveBegin;  /* Where the colour being solved starts in order, for solveChunk(). */
+
+	template<class T>
+	static void grow(T *&Array, int Count, int Capacity)
+	{
+		T *result = new T[Capacity];
+		if (Count > 0)
+			memcpy(result, Array, sizeof(T) * Count);
+		delete [] Array;
+		Array = result;
+	}
+
+	static void* toHandle(int Index)
+	{
+		return (void*)(intptr_t)(Index + 1);
+	}
+
+	static int fromHandle(void *Handle)
+	{
+		return (int)(intptr_t)Handle - 1;
+	}
+
+	int addParticle(float X, float Y, float InverseMass)
+	{
+		if (particleCount == particleCapacity)
+		{
+			int capacity = particleCapacity > 0 ? particleCapacity * 2 : 1024;
+			grow(x,           particleCount, capacity);
+			grow(y,           particleCount, capacity);
+			grow(previousX,   particleCount, capacity);
+			grow(previousY,   particleCount, capacity);
+			grow(velocityX,   particleCount, capacity);
+			grow(velocityY,   particleCount, capacity);
+			grow(inverseMass, particleCount, capacity);
+			grow(usedColours, particleCount, capacity);
+			grow(group,       particleCount, capacity);
+			grow(grounded,    particleCount, capacity);
+			particleCapacity = capacity;
+		}
+
+		x[particleCount]           = X;
+		y[particleCount]           = Y;
+		previousX[particleCount]   = X;
+		previousY[particleCount]   = Y;
+		velocityX[particleCount]   = 0.0f;
+		velocityY[particleCount]   = 0.0f;
+		inverseMass[particleCount] = InverseMass;
+		return particleCount++;
+	}
+
+	int addBody(int First, int Second)
+	{
+		if (bodyCount == bodyCapacity)
+		{
+			int capacity = bodyCapacity > 0 ? bodyCapacity * 2 : 1024;
+			grow(bodyFirst,  bodyCount, capacity);
+			grow(bodySecond, bodyCount, capacity);
+			bodyCapacity = capacity;
+		}
+
+		bodyFirst[bodyCount]  = First;
+		bodySecond[bodyCount] = Second;
+		return bodyCount++;
+	}
+
+	int addConstraint(int A, int B, float Compliance, float Damping, bool Joint)
+	{
+		if (constraintCount == constraintCapacity)
+		{
+			int capacity = constraintCapacity > 0 ? constraintCapacity * 2 : 1024;
+			grow(constraintA, constraintCount, capacity);
+			grow(constraintB, constraintCount, capacity);
+			grow(length,      constraintCount, capacity);
+			grow(compliance,  constraintCount, capacity);
+			grow(damping,     constraintCount, capacity);
+			grow(impulseX,    constraintCount, capacity);
+			grow(impulseY,    constraintCount, capacity);
+			grow(force,       constraintCount, capacity);
+			grow(state,       constraintCount, capacity);
+			delete [] order;
+			delete [] sorted;
+			order              = new int[capacity];
+			sorted             = new int[capacity];
+			constraintCapacity = capacity;
+		}
+
+		float deltaX = x[B] - x[A];
+		float deltaY = y[B] - y[A];
+		constraintA[constraintCount] = A;
+		constraintB[constraintCount] = B;
+		length[constraintCount]      = sqrtf(deltaX * deltaX + deltaY * deltaY);
+		compliance[constraintCount]  = Compliance;
+		damping[constraintCount]     = Damping;
+		impulseX[constraintCount]    = 0.0f;
+		impulseY[constraintCount]    = 0.0f;
+		force[constraintCount]       = 0.0f;
+		state[constraintCount]       = Constraint_Alive | (Joint ? Constraint_Joint : 0);
+		dirty = true;
+		return constraintCount++;
+	}
+
+	/* Works out the compliance and damping that make a constraint between A and B act like a spring of the given
+	   Frequency (in Hz) and damping Ratio, the same way Box2D makes its soft joints. */
+	void spring(int A, int B, float Frequency, float Ratio, float &Compliance, float &Damping)
+	{
+		float weight = inverseMass[A] + inverseMass[B];
+		Compliance   = 0.0f;
+		Damping      = 0.0f;
+		if (weight <= 0.0f)
+			return;
+
+		float mass  = 1.0f / weight;
+		float omega = 2.0f * 3.14159265f * Frequency;
+		Compliance  = 1.0f / (mass * omega * omega);
+		Damping     = 2.0f * mass * Ratio * omega;
+	}
+
+	/* Returns whichever particle of Body is closest to X,Y. */
+	int nearest(int Body, float X, float Y)
+	{
+		int first  = bodyFirst[Body];
+		int second = bodySecond[Body];
+		if (second < 0)
+			return first;
+
+		float firstX  = x[first] - X,  firstY  = y[first] - Y;
+		float secondX = x[second] - X, secondY = y[second] - Y;
+		return firstX * firstX + firstY * firstY <= secondX * secondX + secondY * secondY ? first : second;
+	}
+
+	/* Returns the particle standing for the whole group Particle is in, halving the path there as it goes. */
+	int groupOf(int Particle)
+	{
+		while (group[Particle] != Particle)
+		{
+			group[Particle] = group[group[Particle]];
+			Particle        = group[Particle];
+		}
+		return Particle;
+	}
+
+	static void addIndex(int *&Array, int &Count, int &Capacity, int Index)
+	{
+		if (Count == Capacity)
+		{
+			int capacity = Capacity > 0 ? Capacity * 2 : 256;
+			grow(Array, Count, capacity);
+			Capacity = capacity;
+		}
+		Array[Count++] = Index;
+	}
+
+	/* Greedily gives every live constraint the lowest colour that neither of its particles has been given yet, then
+	   sorts them by colour with a counting sort. Only needs redoing when constraints come or go. */
+	void colour()
+	{
+		int counts[Truss_Colours + 1];
+		memset(counts, 0, sizeof(counts));
+		if (particleCount > 0)
+			memset(usedColours, 0, sizeof(uint64_t) * particleCount);
+
+		/* The colour is parked in order[] until the sort below. */
+		for (int index = 0; index < constraintCount; index++)
+		{
+			if ((state[index] & Constraint_Alive) == 0)
+				continue;
+
+			uint64_t used   = usedColours[constraintA[index]] | usedColours[constraintB[index]];
+			int      colour = 0;
+			while (colour < Truss_Colours - 1 && (used & ((uint64_t)1 << colour)) != 0)
+				colour++;
+			if (colour < Truss_Colours - 1)
+			{
+				usedColours[constraintA[index]] |= (uint64_t)1 << colour;
+				usedColours[constraintB[index]] |= (uint64_t)1 << colour;
+			}
+			order[index] = colour;
+			counts[colour + 1]++;
+		}
+
+		for (int colour = 1; colour <= Truss_Colours; colour++)
+			counts[colour] += counts[colour - 1];
+		memcpy(colourStart, counts, sizeof(colourStart));
+
+		for (int index = 0; index < constraintCount; index++)
+		{
+			if ((state[index] & Constraint_Alive) != 0)
+				sorted[counts[order[index]]++] = index;
+		}
+
+		int *swap = order;
+		order     = sorted;
+		sorted    = swap;
+
+		dirty = false;
+	}
+
+	/* Applies gravity and moves every particle along by its velocity, four at a time where possible. */
+	void integrate(float Step)
+	{
+		int index = 0;
+
+#ifdef PHYSICS_TRUSS_SSE2
+		__m128 step    = _mm_set1_ps(Step);
+		__m128 gravity = _mm_set1_ps(TRUSS_GRAVITY * Step);
+		__m128 zero    = _mm_setzero_ps();
+		for (; index + 4 <= particleCount; index += 4)
+		{
+			__m128 movable   = _mm_cmpgt_ps(_mm_loadu_ps(inverseMass + index), zero);
+			__m128 velocityY = _mm_add_ps(_mm_loadu_ps(this->velocityY + index), _mm_and_ps(movable, gravity));
+			__m128 positionX = _mm_loadu_ps(x + index);
+			__m128 positionY = _mm_loadu_ps(y + index);
+			_mm_storeu_ps(this->velocityY + index, velocityY);
+			_mm_storeu_ps(previousX + index, positionX);
+			_mm_storeu_ps(previousY + index, positionY);
+			_mm_storeu_ps(x + index, _mm_add_ps(positionX, _mm_mul_ps(_mm_loadu_ps(velocityX + index), step)));
+			_mm_storeu_ps(y + index, _mm_add_ps(positionY, _mm_mul_ps(velocityY, step)));
+		}
+#endif
+
+		for (; index < particleCount; index++)
+		{
+			if (inverseMass[index] > 0.0f)
+				velocityY[index] += TRUSS_GRAVITY * Step;
+			previousX[index] = x[index];
+			previousY[index] = y[index];
+			x[index] += velocityX[index] * Step;
+			y[index] += velocityY[index] * Step;
+		}
+	}
+
+	/* Works the velocities out from how far each particle moved during the sub-step. */
+	void updateVelocities(float Step)
+	{
+		float inverseStep = 1.0f / Step;
+		int   index       = 0;
+
+#ifdef PHYSICS_TRUSS_SSE2
+		__m128 scale = _mm_set1_ps(inverseStep);
+		for (; index + 4 <= particleCount; index += 4)
+		{
+			_mm_storeu_ps(velocityX + index, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(x + index), _mm_loadu_ps(previousX + index)), scale));
+			_mm_storeu_ps(velocityY + index, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(y + index), _mm_loadu_ps(previousY + index)), scale));
+		}
+#endif
+
+		for (; index < particleCount; index++)
+		{
+			velocityX[index] = (x[index] - previousX[index]) * inverseStep;
+			velocityY[index] = (y[index] - previousY[index]) * inverseStep;
+		}
+	}
+
+	/* Solves one constraint, the XPBD way: works out how far off the length is, and moves both particles along the
+	   constraint to fix it, heavier ones moving less, softened by the compliance and slowed down by the damping. */
+	void solve(int Constraint, float Step)
+	{
+		int   a      = constraintA[Constraint];
+		int   b      = constraintB[Constraint];
+		float weight = inverseMass[a] + inverseMass[b];
+		float deltaX = x[b] - x[a];
+		float deltaY = y[b] - y[a];
+		float span   = sqrtf(deltaX * deltaX + deltaY * deltaY);
+		if (weight <= 0.0f || span < 1e-6f)
+			return;
+
+		float normalX  = deltaX / span;
+		float normalY  = deltaY / span;
+		float alpha    = compliance[Constraint] / (Step * Step);
+		float gamma    = compliance[Constraint] * damping[Constraint] / Step;
+		float moving   = ((x[b] - previousX[b]) - (x[a] - previousX[a])) * normalX + ((y[b] - previousY[b]) - (y[a] - previousY[a])) * normalY;
+		float lambda   = (-(span - length[Constraint]) - gamma * moving) / ((1.0f + gamma) * weight + alpha);
+
+		x[a] -= inverseMass[a] * lambda * normalX;
+		y[a] -= inverseMass[a] * lambda * normalY;
+		x[b] += inverseMass[b] * lambda * normalX;
+		y[b] += inverseMass[b] * lambda * normalY;
+		impulseX[Constraint] += lambda * normalX / Step;
+		impulseY[Constraint] += lambda * normalY / Step;
+	}
+
+#ifdef PHYSICS_TRUSS_SSE2
+	/* The same as solve(), for four constraints at once. The constraints must not share any particles. */
+	void solveFour(const int *Constraints, float Step)
+	{
+		int a[4], b[4];
+		for (int lane = 0; lane < 4; lane++)
+		{
+			a[lane] = constraintA[Constraints[lane]];
+			b[lane] = constraintB[Constraints[lane]];
+		}
+
+#define GATHER(array, index) _mm_setr_ps(array[index[0]], array[index[1]], array[index[2]], array[index[3]])
+		__m128 xa         = GATHER(x, a),           ya         = GATHER(y, a);
+		__m128 xb         = GATHER(x, b),           yb         = GATHER(y, b);
+		__m128 movedXa    = _mm_sub_ps(xa, GATHER(previousX, a));
+		__m128 movedYa    = _mm_sub_ps(ya, GATHER(previousY, a));
+		__m128 movedXb    = _mm_sub_ps(xb, GATHER(previousX, b));
+		__m128 movedYb    = _mm_sub_ps(yb, GATHER(previousY, b));
+		__m128 weightA    = GATHER(inverseMass, a), weightB    = GATHER(inverseMass, b);
+		__m128 rest       = GATHER(length, Constraints);
+		__m128 soft       = GATHER(compliance, Constraints);
+		__m128 damp       = GATHER(damping, Constraints);
+#undef GATHER
+
+		__m128 one        = _mm_set1_ps(1.0f);
+		__m128 deltaX     = _mm_sub_ps(xb, xa);
+		__m128 deltaY     = _mm_sub_ps(yb, ya);
+		__m128 span       = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(deltaX, deltaX), _mm_mul_ps(deltaY, deltaY)));
+		__m128 weight     = _mm_add_ps(weightA, weightB);
+		__m128 valid      = _mm_and_ps(_mm_cmpgt_ps(weight, _mm_setzero_ps()), _mm_cmpge_ps(span, _mm_set1_ps(1e-6f)));
+		__m128 safeSpan   = _mm_max_ps(span, _mm_set1_ps(1e-6f));
+		__m128 normalX    = _mm_div_ps(deltaX, safeSpan);
+		__m128 normalY    = _mm_div_ps(deltaY, safeSpan);
+		__m128 alpha      = _mm_div_ps(soft, _mm_set1_ps(Step * Step));
+		__m128 gamma      = _mm_div_ps(_mm_mul_ps(soft, damp), _mm_set1_ps(Step));
+		__m128 moving     = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(movedXb, movedXa), normalX), _mm_mul_ps(_mm_sub_ps(movedYb, movedYa), normalY));
+		__m128 numerator  = _mm_sub_ps(_mm_sub_ps(rest, span), _mm_mul_ps(gamma, moving));
+		__m128 divisor    = _mm_add_ps(_mm_mul_ps(_mm_add_ps(one, gamma), weight), alpha);
+		__m128 lambda     = _mm_and_ps(valid, _mm_div_ps(numerator, _mm_max_ps(divisor, _mm_set1_ps(1e-12f))));
+
+		float outX[4], outY[4];
+		_mm_storeu_ps(outX,      _mm_mul_ps(lambda, normalX));
+		_mm_storeu_ps(outY,      _mm_mul_ps(lambda, normalY));
+		for (int lane = 0; lane < 4; lane++)
+		{
+			x[a[lane]] -= inverseMass[a[lane]] * outX[lane];
+			y[a[lane]] -= inverseMass[a[lane]] * outY[lane];
+			x[b[lane]] += inverseMass[b[lane]] * outX[lane];
+			y[b[lane]] += inverseMass[b[lane]] * outY[lane];
+			impulseX[Constraints[lane]] += outX[lane] / Step;
+			impulseY[Constraints[lane]] += outY[lane] / Step;
+		}
+	}
+#endif
+
+	/* Solves order[Begin..End-1], which must all be the same colour. */
+	void solveRange(int Begin, int End, float Step)
+	{
+		int index = Begin;
+#ifdef PHYSICS_TRUSS_SSE2
+		for (; index + 4 <= End; index += 4)
+			solveFour(order + index, Step);
+#endif
+		for (; index < End; index++)
+			solve(order[index], Step);
+	}
+
+	static void solveChunk(void *Context, int Begin, int End)
+	{
+		PhysicsTruss *physics = (PhysicsTruss*)Context;
+		physics->solveRange(physics->solveBegin + Begin, physics->solveBegin + End, physics->solveStep);
+	}
+
+	/* Solves every constraint once, a colour at a time. */
+	void solveConstraints(float Step)
+	{
+		for (int colour = 0; colour < Truss_Colours - 1; colour++)
+		{
+			int begin = colourStart[colour];
+			int end   = colourStart[colour + 1];
+			if (threadPool != NULL && end - begin >= Simulation_ParallelJoints)
+			{
+				solveStep  = Step;
+				solveBegin = begin;
+				threadPool->Run(solveChunk, this, end - begin, Simulation_JointChunk);
+			}
+			else
+				solveRange(begin, end, Step);
+		}
+
+		/* The leftovers can share particles, so they're done one by one. */
+		for (int index = colourStart[Truss_Colours - 1]; index < colourStart[Truss_Colours]; index++)
+			solve(order[index], Step);
+	}
+
+	/* Pushes Particle out of the way of Other by Distance along Normal, the two sharing the push by their weight,
+	   with a bit of friction taken off the particle's sideways movement. */
+	void push(int Particle, float NormalX, float NormalY, float Distance, float OtherWeight, float &OtherX, float &OtherY)
+	{
+		float weight = inverseMass[Particle] + OtherWeight;
+		if (weight <= 0.0f)
+			return;
+
+		float share = Distance / weight;
+		x[Particle] += inverseMass[Particle] * share * NormalX;
+		y[Particle] += inverseMass[Particle] * share * NormalY;
+		OtherX       = -OtherWeight * share * NormalX;
+		OtherY       = -OtherWeight * share * NormalY;
+
+		float sideways = (x[Particle] - previousX[Particle]) * -NormalY + (y[Particle] - previousY[Particle]) * NormalX;
+		float limit    = TRUSS_FRICTION * Distance;
+		float slowdown = sideways > limit ? limit : (sideways < -limit ? -limit : sideways);
+		x[Particle] -= slowdown * -NormalY;
+		y[Particle] -= slowdown * NormalX;
+	}
+
+	/* Keeps the boxes out of the slabs and each other. There are only ever a handful of boxes, so each is simply
+	   checked against everything. */
+	void collide()
+	{
+		const float reach = TRUSS_BOX_RADIUS + TRUSS_SLAB_HEIGHT / 2.0f;
+		for (int box = 0; box < boxCount; box++)
+		{
+			int particle = boxes[box];
+
+			for (int rod = 0; rod < rodCount; rod++)
+			{
+				int   a      = constraintA[rods[rod]];
+				int   b      = constraintB[rods[rod]];
+				float px     = x[particle], py = y[particle];
+				if ((px + reach < x[a] && px + reach < x[b]) || (px - reach > x[a] && px - reach > x[b]) ||
+				    (py + reach < y[a] && py + reach < y[b]) || (py - reach > y[a] && py - reach > y[b]))
+					continue;
+
+				/* Find the closest point on the slab... */
+				float deltaX = x[b] - x[a];
+				float deltaY = y[b] - y[a];
+				float span   = deltaX * deltaX + deltaY * deltaY;
+				float along  = span > 0.0f ? ((px - x[a]) * deltaX + (py - y[a]) * deltaY) / span : 0.0f;
+				along        = along < 0.0f ? 0.0f : (along > 1.0f ? 1.0f : along);
+				float awayX  = px - (x[a] + deltaX * along);
+				float awayY  = py - (y[a] + deltaY * along);
+				float away   = sqrtf(awayX * awayX + awayY * awayY);
+				if (away >= reach || away < 1e-6f)
+					continue;
+
+				/* ... and push the box and the two ends of the slab apart, the end nearest the box taking most of it. */
+				float weightA = inverseMass[a] * (1.0f - along) * (1.0f - along);
+				float weightB = inverseMass[b] * along * along;
+				float pushX, pushY;
+				push(particle, awayX / away, awayY / away, reach - away, weightA + weightB, pushX, pushY);
+				if (weightA + weightB > 0.0f)
+				{
+					float shareA = inverseMass[a] * (1.0f - along) / (weightA + weightB);
+					float shareB = inverseMass[b] * along / (weightA + weightB);
+					x[a] += pushX * shareA;
+					y[a] += pushY * shareA;
+					x[b] += pushX * shareB;
+					y[b] += pushY * shareB;
+				}
+			}
+
+			for (int other = box + 1; other < boxCount; other++)
+			{
+				int   them   = boxes[other];
+				float awayX  = x[particle] - x[them];
+				float awayY  = y[particle] - y[them];
+				float away   = sqrtf(awayX * awayX + awayY * awayY);
+				if (away >= 2.0f * TRUSS_BOX_RADIUS || away < 1e-6f)
+					continue;
+
+				float pushX, pushY;
+				push(particle, awayX / away, awayY / away, 2.0f * TRUSS_BOX_RADIUS - away, inverseMass[them], pushX, pushY);
+				x[them] += pushX;
+				y[them] += pushY;
+			}
+		}
+	}
+
+public:
+	PhysicsTruss()
+	{
+		x                  = NULL;
+		y                  = NULL;
+		previousX          = NULL;
+		previousY          = NULL;
+		velocityX          = NULL;
+		velocityY          = NULL;
+		inverseMass        = NULL;
+		usedColours        = NULL;
+		group              = NULL;
+		grounded           = NULL;
+		particleCount      = 0;
+		particleCapacity   = 0;
+		bodyFirst          = NULL;
+		bodySecond         = NULL;
+		bodyCount          = 0;
+		bodyCapacity       = 0;
+		constraintA        = NULL;
+		constraintB        = NULL;
+		length             = NULL;
+		compliance         = NULL;
+		damping            = NULL;
+		impulseX           = NULL;
+		impulseY           = NULL;
+		force              = NULL;
+		state              = NULL;
+		order              = NULL;
+		sorted             = NULL;
+		constraintCount    = 0;
+		constraintCapacity = 0;
+		boxes              = NULL;
+		boxCount           = 0;
+		boxCapacity        = 0;
+		rods               = NULL;
+		rodCount           = 0;
+		rodCapacity        = 0;
+		created            = false;
+		dirty              = false;
+		memset(colourStart, 0, sizeof(colourStart));
+	}
+
+	~PhysicsTruss()
+	{
+		delete [] x;
+		delete [] y;
+		delete [] previousX;
+		delete [] previousY;
+		delete [] velocityX;
+		delete [] velocityY;
+		delete [] inverseMass;
+		delete [] usedColours;
+		delete [] group;
+		delete [] grounded;
+		delete [] bodyFirst;
+		delete [] bodySecond;
+		delete [] constraintA;
+		delete [] constraintB;
+		delete [] length;
+		delete [] compliance;
+		delete [] damping;
+		delete [] impulseX;
+		delete [] impulseY;
+		delete [] force;
+		delete [] state;
+		delete [] order;
+		delete [] sorted;
+		delete [] boxes;
+		delete [] rods;
+	}
+
+	bool Create()
+	{
+		Destroy();
+		created = true;
+		return true;
+	}
+
+	/* Everything is simply forgotten, the arrays are kept for the next Create(). */
+	bool Destroy()
+	{
+		particleCount   = 0;
+		bodyCount       = 0;
+		constraintCount = 0;
+		boxCount        = 0;
+		rodCount        = 0;
+		created         = false;
+		dirty           = true;
+		return false;
+	}
+
+	void Step(float TimeStep)
+	{
+		if (!created)
+			return;
+
+		if (dirty)
+			colour();
+
+		if (constraintCount > 0)
+		{
+			memset(impulseX, 0, sizeof(float) * constraintCount);
+			memset(impulseY, 0, sizeof(float) * constraintCount);
+		}
+
+		float step = TimeStep / Truss_Substeps;
+		for (int substep = 0; substep < Truss_Substeps; substep++)
+		{
+			integrate(step);
+			solveConstraints(step);
+			collide();
+			updateVelocities(step);
+		}
+	}
+
+	void RemoveJoint(void *Joint)
+	{
+		state[fromHandle(Joint)] &= ~Constraint_Alive;
+		dirty = true;
+	}
+
+	/* Every constraint on the body's particles dies, and the particles are made immovable and forgotten by the
+	   collision lists, so they simply stay where they are with nothing referring to them until the next Create(). */
+	void RemoveBody(void *Body)
+	{
+		int body = fromHandle(Body);
+		for (int end = 0; end < 2; end++)
+		{
+			int particle = end == 0 ? bodyFirst[body] : bodySecond[body];
+			if (particle < 0)
+				continue;
+
+			for (int index = 0; index < constraintCount; index++)
+			{
+				if (constraintA[index] == particle || constraintB[index] == particle)
+					state[index] &= ~Constraint_Alive;
+			}
+			inverseMass[particle] = 0.0f;
+			velocityX[particle]   = 0.0f;
+			velocityY[particle]   = 0.0f;
+
+			for (int index = boxCount - 1; index >= 0; index--)
+			{
+				if (boxes[index] == particle)
+					boxes[index] = boxes[--boxCount];
+			}
+		}
+
+		for (int index = rodCount - 1; index >= 0; index--)
+		{
+			if ((state[rods[index]] & Constraint_Alive) == 0)
+				rods[index] = rods[--rodCount];
+		}
+		dirty = true;
+	}
+
+	/* The particles are grouped by the live constraints between them with a union-find, and a group is grounded if
+	   any particle in it can't move. A group is numbered after the particle standing for it. */
+	void GetGroups(void **Bodies, int Count, int *Groups, bool *Grounded)
+	{
+		if (created)
+		{
+			for (int index = 0; index < particleCount; index++)
+			{
+				group[index]    = index;
+				grounded[index] = false;
+			}
+			for (int index = 0; index < constraintCount; index++)
+			{
+				if ((state[index] & Constraint_Alive) != 0)
+					group[groupOf(constraintA[index])] = groupOf(constraintB[index]);
+			}
+			for (int index = 0; index < particleCount; index++)
+			{
+				if (inverseMass[index] <= 0.0f)
+					grounded[groupOf(index)] = true;
+			}
+		}
+
+		for (int index = 0; index < Count; index++)
+		{
+			int root        = created && Bodies[index] != NULL ? groupOf(bodyFirst[fromHandle(Bodies[index])]) : -1;
+			Groups[index]   = root;
+			Grounded[index] = root >= 0 && grounded[root];
+		}
+	}
+
+	/* Slabs are measured at their middle, and are at rest once both ends are. */
+	int FindDebris(void **Bodies, int Count, float Left, float Right, float Bottom, const bool *Loose, bool *Debris)
+	{
+		memset(Debris, 0, sizeof(bool) * Count);
+		if (!created)
+			return 0;
+
+		int result = 0;
+		for (int index = 0; index < Count; index++)
+		{
+			if (Bodies[index] == NULL)
+				continue;
+
+			int body   = fromHandle(Bodies[index]);
+			int first  = bodyFirst[body];
+			int second = bodySecond[body] >= 0 ? bodySecond[body] : first;
+			if (inverseMass[first] <= 0.0f && inverseMass[second] <= 0.0f)
+				continue;
+
+			float positionX = (x[first] + x[second]) / 2.0f;
+			float positionY = (y[first] + y[second]) / 2.0f;
+			bool  resting   = velocityX[first]  * velocityX[first]  + velocityY[first]  * velocityY[first]  < TRUSS_REST * TRUSS_REST &&
+			                  velocityX[second] * velocityX[second] + velocityY[second] * velocityY[second] < TRUSS_REST * TRUSS_REST;
+			Debris[index]   = positionY < Bottom || positionX < Left || positionX > Right ||
+			                  (Loose != NULL && Loose[index] && resting);
+			result += Debris[index] ? 1 : 0;
+		}
+		return result;
+	}
+
+	/* Single particles don't rotate, slabs point from their first end to their second. */
+	void GetTransforms(void **Bodies, int Count, TransformStore::Set &Result)
+	{
+		/* If the simulation isn't running, return having not modified a thing. */
+		if (!created)
+			return;
+
+		for (int index = 0; index < Count; index++)
+		{
+			if (Bodies[index] == NULL)
+				continue;
+
+			int body   = fromHandle(Bodies[index]);
+			int first  = bodyFirst[body];
+			int second = bodySecond[body];
+			if (second < 0)
+			{
+				Result.X[index]      = x[first];
+				Result.Y[index]      = y[first];
+				Result.Cosine[index] = 1.0f;
+				Result.Sine[index]   = 0.0f;
+				continue;
+			}
+
+			float deltaX = x[second] - x[first];
+			float deltaY = y[second] - y[first];
+			float span   = sqrtf(deltaX * deltaX + deltaY * deltaY);
+			Result.X[index]      = x[first] + deltaX / 2.0f;
+			Result.Y[index]      = y[first] + deltaY / 2.0f;
+			Result.Cosine[index] = span > 0.0f ? deltaX / span : 1.0f;
+			Result.Sine[index]   = span > 0.0f ? deltaY / span : 0.0f;
+		}
+	}
+
+	/* Each body's state is the position and velocity of its first particle, then of its second if it has one. */
+	void SaveState(void **Bodies, int Count, float *State)
+	{
+		if (!created)
+			return;
+
+		for (int index = 0; index < Count; index++, State += Simulation_StateSize)
+		{
+			if (Bodies[index] == NULL)
+				continue;
+
+			int body = fromHandle(Bodies[index]);
+			for (int end = 0; end < 2; end++)
+			{
+				int    particle = end == 0 ? bodyFirst[body] : bodySecond[body];
+				float *state    = State + end * 4;
+				if (particle < 0)
+					continue;
+
+				state[0] = x[particle];
+				state[1] = y[particle];
+				state[2] = velocityX[particle];
+				state[3] = velocityY[particle];
+			}
+		}
+	}
+
+	void LoadState(void **Bodies, int Count, const float *State)
+	{
+		if (!created)
+			return;
+
+		for (int index = 0; index < Count; index++, State += Simulation_StateSize)
+		{
+			if (Bodies[index] == NULL)
+				continue;
+
+			int body = fromHandle(Bodies[index]);
+			for (int end = 0; end < 2; end++)
+			{
+				int          particle = end == 0 ? bodyFirst[body] : bodySecond[body];
+				const float *state    = State + end * 4;
+				if (particle < 0)
+					continue;
+
+				x[particle]         = previousX[particle] = state[0];
+				y[particle]         = previousY[particle] = state[1];
+				velocityX[particle] = state[2];
+				velocityY[particle] = state[3];
+			}
+		}
+	}
+
+	/* The force is the impulse summed over the last Step() times Delta, which is what PhysicsBox2D reports too. */
+	int HandleForces(float Delta, float Maximum)
+	{
+		int result = 0;
+		if (!created)
+			return result;
+
+		for (int index = 0; index < constraintCount; index++)
+		{
+			if ((state[index] & (Constraint_Alive | Constraint_Joint)) != (Constraint_Alive | Constraint_Joint))
+				continue;
+
+			force[index] = sqrtf(impulseX[index] * impulseX[index] + impulseY[index] * impulseY[index]) * Delta;
+			if (force[index] >= Maximum)
+			{
+				state[index] &= ~Constraint_Alive;
+				result++;
+			}
+		}
+
+		if (result > 0)
+			dirty = true;
+		return result;
+	}
+
+	float GetJointForce(void *&Joint)
+	{
+		/* If the simulation isn't running, return having not modified a thing. */
+		if (Joint == NULL || !created)
+			return 0.0f;
+
+		int constraint = fromHandle(Joint);
+		if ((state[constraint] & Constraint_Alive) == 0)
+		{
+			Joint = NULL;
+			return 0.0f;
+		}
+		return force[constraint];
+	}
+
+	void* AddPin(float X, float Y, bool Fixed)
+	{
+		int particle = addParticle(X, Y, Fixed ? 0.0f : 1.0f / TRUSS_PIN_MASS);
+		return toHandle(addBody(particle, -1));
+	}
+
+	/* A slab pinned to the two pins at its ends. */
+	void* AddStructure(void *Left, void *Right)
+	{
+		int   left   = bodyFirst[fromHandle(Left)];
+		int   right  = bodyFirst[fromHandle(Right)];
+		void *result = AddSlab(x[left], y[left], x[right], y[right]);
+
+		Join(Left, result, x[left], y[left]);
+		Join(result, Right, x[right], y[right]);
+		return result;
+	}
+
+	/* A particle at each end carrying half the slab's weight, held apart by a rigid rod. */
+	void* AddSlab(float X1, float Y1, float X2, float Y2)
+	{
+		float deltaX = X2 - X1;
+		float deltaY = Y2 - Y1;
+		float mass   = TRUSS_DENSITY * sqrtf(deltaX * deltaX + deltaY * deltaY) * TRUSS_SLAB_HEIGHT;
+		float weight = mass > 0.0f ? 2.0f / mass : 1.0f;
+		int   first  = addParticle(X1, Y1, weight);
+		int   second = addParticle(X2, Y2, weight);
+
+		addIndex(rods, rodCount, rodCapacity, addConstraint(first, second, 0.0f, 0.0f, false));
+		return toHandle(addBody(first, second));
+	}
+
+	/* A breakable zero-length constraint between whichever particles of the two bodies are nearest X,Y. */
+	void* Join(void *First, void *Second, float X, float Y)
+	{
+		int   first  = nearest(fromHandle(First),  X, Y);
+		int   second = nearest(fromHandle(Second), X, Y);
+		float soft, damp;
+		spring(first, second, TRUSS_PIN_FREQ, TRUSS_PIN_DAMP, soft, damp);
+		return toHandle(addConstraint(first, second, soft, damp, true));
+	}
+
+	/* Join() pins the particles of the two bodies nearest X,Y together, so that's the pair to look for. */
+	void* FindJoint(void *First, void *Second, float X, float Y)
+	{
+		int first  = nearest(fromHandle(First),  X, Y);
+		int second = nearest(fromHandle(Second), X, Y);
+		for (int index = 0; index < constraintCount; index++)
+		{
+			if ((state[index] & (Constraint_Alive | Constraint_Joint)) != (Constraint_Alive | Constraint_Joint))
+				continue;
+			if ((constraintA[index] == first && constraintB[index] == second) || (constraintA[index] == second && constraintB[index] == first))
+				return toHandle(index);
+		}
+		return NULL;
+	}
+
+	/* A spring, as stiff and damped as a Box2D distance joint with the same frequency and damping ratio would be for
+	   the two pins it joins. */
+	void* AddSupport(void *Left, void *Right)
+	{
+		int   left  = bodyFirst[fromHandle(Left)];
+		int   right = bodyFirst[fromHandle(Right)];
+		float soft, damp;
+		spring(left, right, JOINT_FREQ, JOINT_DAMP, soft, damp);
+		return toHandle(addConstraint(left, right, soft, damp, true));
+	}
+
+	void* AddBox(float X, float Y, float Mass)
+	{
+		if (!created)
+			return NULL;
+
+		int particle = addParticle(X, Y, Mass > 0.0f ? 1.0f / (Mass * 4.0f) : 1.0f); /* Box2D's 2x2 box with Mass as its density. */
+		addIndex(boxes, boxCount, boxCapacity, particle);
+		return toHandle(addBody(particle, -1));
+	}
+};
+
+#endif
@@ -19,18 +19,20 @@ Permission is granted to anyone to use this software for any purpose, including
 class Pin
 {
 public:
-	Pin         *Next;         /* The next Pin instance in the linked-list. */
+	Pin         *GridNext;     /* The next Pin in the same PinGrid bucket. */
 	Positioning  Transform;    /* The position of this pin while at rest, and the current position. */
 	bool         Fixed;        /* Set this to true if the Pin must not move, e.g., attached to ground. */
 	void        *PhysicBody;   /* Points to the object instance within the Physics world instance. */
+	int          FirstSlab;    /* The index of the first slab attached to this pin, or -1, see Slab::NextLeft. */
 
 protected:
-	void initialise(float X, float Y, bool Fixed)
+	void initialise(TransformStore *Store, float X, float Y, bool Fixed)
 	{
 		this->Fixed = Fixed;
-		Next        = NULL;
+		GridNext    = NULL;
 		PhysicBody  = NULL;
-		Transform.Initialise(X, Y, 0);
+		FirstSlab   = -1;
+		Transform.Initialise(Store, X, Y, 0);
 	}
 
 	/* Hide the default constructor as a Pin should always be created with a position. */
@@ -39,9 +41,10 @@ protected:
 	}
 
 public:
-	Pin(float X, float Y, bool Fixed)
+	/* Store is where the bridge keeps the transforms of all its pins and slabs. */
+	Pin(TransformStore *Store, float X, float Y, bool Fixed)
 	{
-		initialise(X,Y, Fixed);
+		initialise(Store, X,Y, Fixed);
 	}
 };
 
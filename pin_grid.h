@@ -0,0 +1,152 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __PIN_GRID_H_
+#define __PIN_GRID_H_
+
+#include <math.h>
+#include <string.h>
+#include "pin.h"
+
+/* This is a spatial hash of pins by their edit-time position, so that finding the pin under a touch doesn't mean
+   walking every pin in the bridge.
+   The world is split into square cells of CellSize, and each cell is hashed into a bucket. Pins in the same bucket
+   are chained together through Pin->GridNext, so the grid never allocates anything per pin.
+   The bucket table doubles in size whenever there are more pins than buckets, keeping the chains short. */
+class PinGrid
+{
+protected:
+	enum
+	{
+		InitialBuckets = 256, /* Must be a power of two. */
+	};
+
+protected:
+	Pin   **buckets;
+	int     bucketCount;
+	int     pinCount;
+	float   cellSize;
+
+	int cell(float Value)
+	{
+		return (int)floor(Value / cellSize);
+	}
+
+	unsigned int bucket(int CellX, int CellY)
+	{
+		return (((unsigned int)CellX * 73856093u) ^ ((unsigned int)CellY * 19349663u)) & (bucketCount - 1);
+	}
+
+	unsigned int bucket(Pin *Target)
+	{
+		return bucket(cell(Target->Transform.OriginalX()), cell(Target->Transform.OriginalY()));
+	}
+
+	void resize(int Count)
+	{
+		Pin **old      = buckets;
+		int   oldCount = bucketCount;
+
+		bucketCount = Count;
+		buckets     = new Pin*[bucketCount];
+		memset(buckets, 0, sizeof(Pin*) * bucketCount);
+
+		for (int index = 0; index < oldCount; index++)
+		{
+			Pin *pin = old[index];
+			while (pin)
+			{
+				Pin          *next  = pin->GridNext;
+				unsigned int  which = bucket(pin);
+				pin->GridNext       = buckets[which];
+				buckets[which]      = pin;
+				pin = next;
+			}
+		}
+		delete [] old;
+	}
+
+public:
+	PinGrid(float CellSize)
+	{
+		buckets     = NULL;
+		bucketCount = 0;
+		pinCount    = 0;
+		cellSize    = CellSize;
+		resize(InitialBuckets);
+	}
+
+	~PinGrid()
+	{
+		delete [] buckets;
+	}
+
+	/* Forgets about all pins, without touching the pins themselves. */
+	void Clear()
+	{
+		memset(buckets, 0, sizeof(Pin*) * bucketCount);
+		pinCount = 0;
+	}
+
+	void Add(Pin *Target)
+	{
+		if (pinCount >= bucketCount)
+			resize(bucketCount * 2);
+
+		unsigned int which = bucket(Target);
+		Target->GridNext   = buckets[which];
+		buckets[which]     = Target;
+		pinCount++;
+	}
+
+	void Remove(Pin *Target)
+	{
+		Pin **link = &buckets[bucket(Target)];
+		while (*link)
+		{
+			if (*link == Target)
+			{
+				*link            = Target->GridNext;
+				Target->GridNext = NULL;
+				pinCount--;
+				return;
+			}
+			link = &(*link)->GridNext;
+		}
+	}
+
+	/* Returns a pin whose edit-time position is within Accuracy of X,Y on both axes, or NULL if there is none.
+	   Only the cells overlapping that square are looked at. */
+	Pin* Find(float X, float Y, float Accuracy)
+	{
+		int left   = cell(X - Accuracy);
+		int right  = cell(X + Accuracy);
+		int bottom = cell(Y - Accuracy);
+		int top    = cell(Y + Accuracy);
+
+		for (int cellY = bottom; cellY <= top; cellY++)
+		{
+			for (int cellX = left; cellX <= right; cellX++)
+			{
+				Pin *pin = buckets[bucket(cellX, cellY)];
+				while (pin)
+				{
+					if ( (fabs(pin->Transform.OriginalX() - X) <= Accuracy) && (fabs(pin->Transform.OriginalY() - Y) <= Accuracy) )
+						return pin;
+					pin = pin->GridNext;
+				}
+			}
+		}
+		return NULL;
+	}
+};
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __POOL_H_
+#define __POOL_H_
+
+#include <new>
+#include <string.h>
+
+/* This stores instances of T back to back in fixed size chunks of memory, instead of each one being new'd on its own.
+   Walking the items in index order is then (nearly) a linear walk through memory, and because chunks are never moved
+   once allocated, pointers to items and their indices stay valid for as long as the item exists (the one exception
+   being Remove(), which moves the last item into the gap it leaves).
+
+   Allocate() only hands out the memory for the next item, the caller constructs it in place:
+     Pin *pin = new (pins.Allocate()) Pin(X, Y, false);
+
+   Clear() simply forgets all items and keeps the chunks around for reuse, so it costs the same no matter how many items
+   there were. That also means item destructors are never called, so T must not need one. */
+template <class T, int ChunkSize = 256>
+class Pool
+{
+protected:
+	unsigned char **chunks;
+	int             chunkCount;    /* How many chunks have been allocated so far. */
+	int             chunkCapacity; /* How many chunk pointers the chunks array has room for. */
+	int             count;         /* How many items are in use. */
+
+public:
+	Pool()
+	{
+		chunks        = NULL;
+		chunkCount    = 0;
+		chunkCapacity = 0;
+		count         = 0;
+	}
+
+	~Pool()
+	{
+		for (int index = 0; index < chunkCount; index++)
+			::operator delete(chunks[index]);
+		delete [] chunks;
+	}
+
+	/* Returns uninitialised memory for one more item, at index Count() - 1. */
+	void* Allocate()
+	{
+		if (count == chunkCount * ChunkSize)
+		{
+			if (chunkCount == chunkCapacity)
+			{
+				int              capacity = chunkCapacity > 0 ? chunkCapacity * 2 : 16;
+				unsigned char  **grown    = new unsigned char*[capacity];
+				if (chunkCount > 0)
+					memcpy(grown, chunks, sizeof(unsigned char*) * chunkCount);
+				delete [] chunks;
+				chunks        = grown;
+				chunkCapacity = capacity;
+			}
+			chunks[chunkCount++] = (unsigned char*)::operator new(sizeof(T) * ChunkSize);
+		}
+
+		return Get(count++);
+	}
+
+	void Clear()
+	{
+		count = 0;
+	}
+
+	/* Removes the item at Index by moving the last item into its place, keeping the items back to back. Anything
+	   pointing at the last item has to be pointed at Index afterwards. */
+	void Remove(int Index)
+	{
+		count--;
+		if (Index != count)
+			memcpy((void*)Get(Index), (void*)Get(count), sizeof(T));
+	}
+
+	int Count()
+	{
+		return count;
+	}
+
+	T* Get(int Index)
+	{
+		return (T*)(chunks[Index / ChunkSize] + sizeof(T) * (Index % ChunkSize));
+	}
+
+	T* operator[](int Index)
+	{
+		return Get(Index);
+	}
+
+	/* Returns the most recently allocated item, or NULL if there are none. */
+	T* Last()
+	{
+		return count > 0 ? Get(count - 1) : NULL;
+	}
+};
+
+#endif
@@ -12,82 +12,107 @@ Permission is granted to anyone to use this software for any purpose, including
 #ifndef __POSITIONING_H_
 #define __POSITIONING_H_
 
-/* The main purpose of this class is to store the position and angle of a piece of bridge (pin/slab).
+#include <math.h>
+#include "transform_store.h"
+
+/* The main purpose of this class is to get at the position and angle of a piece of bridge (pin/slab).
    Other objects simply obtain the position for e.g., drawing by calling X(), Y() and Angle().
 
+   The values themselves live in a TransformStore shared by the whole bridge, this is only a handle to one index in it.
+   That lets the physics engine and drawing code work on all the transforms at once, while code dealing with a single
+   pin or slab can still ask it where it is.
+
    The idea is to initialise an instance with a position and angle, this being regarded as the edit time position,
-   then when the physics engine does its stuff, it can set the position to its new temporary position.
+   then when the physics engine does its stuff, it sets the position to its new temporary position in the store.
 
    This means that the X(), Y() and Angle() calls always return the CURRENT values, regardless of whether it
    is during editing or simulation.
 
-   A call to Reset() sets the values back to their edit-time/original values.
+   A call to TransformStore::Reset() sets the values of every handle back to their edit-time/original values.
 
    Usage:
    10 call Initialise() with the edit-time information (drawing calls X(), Y() and Angle())
    20 change to simulation mode
-   30 the physics engine calls Set() with the new temporary values (drawing still calls X(), Y() and Angle())
+   30 the physics engine fills in the store with the new temporary values (drawing still calls X(), Y() and Angle())
    40 changing to edit mode
-   50 call Reset()
+   50 call TransformStore::Reset()
    60 goto 10
    */
 class Positioning
 {
 protected:
-	enum
-	{
-		Original = 0,
-		Current,
-	};
-
-protected:
-	float x[2];
-	float y[2];
-	float angle[2];
+	TransformStore *store;
+	int             index;
 
 public:
 	Positioning()
 	{
-		x[0] = x[1] = y[0] = y[1] = angle[0] = angle[1] = 0;
+		store = NULL;
+		index = -1;
 	}
 
-	void Initialise(float X, float Y, float Angle)
+	/* The first call takes an index in Store, later calls update the edit-time values of that same index. */
+	void Initialise(TransformStore *Store, float X, float Y, float Angle)
 	{
-		x[Original]     = X;
-		x[Current]      = x[Original];
-		y[Original]     = Y;
-		y[Current]      = y[Original];
-		angle[Original] = Angle;
-		angle[Current]  = angle[Original];
+		if (store == Store && index >= 0)
+		{
+			store->Initialise(index, X, Y, Angle);
+			return;
+		}
+		store = Store;
+		index = store->Add(X, Y, Angle);
 	}
 
-	void Set(float X, float Y, float Angle)
+	/* Tells the store which physics engine body this entry follows while simulating. */
+	void SetBody(void *Body)
 	{
-		x[Current]     = X;
-		y[Current]     = Y;
-		angle[Current] = Angle;
+		store->Bodies()[index] = Body;
 	}
 
-	void Reset()
+	TransformStore* Store()
 	{
-		x[Current]     = x[Original];
-		y[Current]     = y[Original];
-		angle[Current] = angle[Original];
+		return store;
+	}
+
+	int Index()
+	{
+		return index;
 	}
 
 	float X()
 	{
-		return x[Current];
+		return store->Get(TransformStore::Current).X[index];
 	}
 
 	float Y()
 	{
-		return y[Current];
+		return store->Get(TransformStore::Current).Y[index];
+	}
+
+	float Cosine()
+	{
+		return store->Get(TransformStore::Current).Cosine[index];
+	}
+
+	float Sine()
+	{
+		return store->Get(TransformStore::Current).Sine[index];
 	}
 
 	float Angle()
 	{
-		return angle[Current];
+		return atan2(Sine(), Cosine());
+	}
+
+	/* These return the edit-time values, regardless of what the physics engine has done since. */
+	float OriginalX()
+	{
+		return store->Get(TransformStore::Original).X[index];
+	}
+
+	float OriginalY()
+	{
+		return store->Get(TransformStore::Original).Y[index];
 	}
 };
 
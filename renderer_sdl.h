@@ -0,0 +1,335 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __RENDERER_SDL_H_
+#define __RENDERER_SDL_H_
+
+#include <math.h>
+#include "SDL/SDL.h"
+#include "renderer.h"
+#include "dirty_rects.h"
+#include "clipping.h"
+#include "draw_list.h"
+#include "simd_transform.h"
+#include "tile_rasterizer.h"
+
+#define BPP         32
+#define PIXELBUFFER Uint32
+#define SCREENX(x)  ((x) * scale + halfWidth + offsetX)
+#define SCREENY(y)  (screenHeight - ((y) * scale + halfHeight + offsetY))
+
+/* This is a simple renderer with throw-away code that uses SDL for drawing lines and circles.
+   CAUTION: you shouldn't try to learn anything from this code except the usual "how not to do something".
+
+   Rather than clearing and presenting the whole screen every frame, it remembers the areas each primitive touched.
+   At the start of a frame only the areas drawn in the last frame are cleared, and at the end only those and the
+   areas drawn in this frame are sent to the screen.
+
+   Line(), Circle() and Text() don't touch the screen themselves, they only record what to draw in a DrawList.
+   FrameEnd() then draws the lot in one go, locking the screen just the once. Given a ThreadPool, the drawing is
+   split up into tiles that are drawn in parallel, see TileRasterizer. */
+class RendererSDL : public Renderer
+{
+private:
+    SDL_Surface *screen;
+	float        scale;
+	float        offsetX;
+	float        offsetY;
+	int          screenWidth;
+	int          screenHeight;
+	int          frameRate;
+	int          halfWidth;
+	int          halfHeight;
+	DirtyRects   drawn;       /* The areas drawn to so far this frame. */
+	DirtyRects   previous;    /* The areas drawn to last frame, which still have last frame's drawing in them. */
+	SDL_Rect     updates[DirtyRects::MaxRects];
+	DrawList     commands;    /* Everything drawn so far this frame, which only really gets drawn in FrameEnd(). */
+	TileRasterizer tiles;     /* Draws the commands in parallel tiles when there is a thread pool. */
+	ThreadPool  *threadPool;  /* Optional, for drawing with more than one thread. */
+
+protected:
+	PIXELBUFFER* lock()
+	{
+		if (SDL_MUSTLOCK(screen))
+		{
+			if (SDL_LockSurface(screen) < 0)
+			{
+				printf("Error locking surface: %s\n", SDL_GetError());
+				abort();
+			}
+		}
+		return (PIXELBUFFER*)screen->pixels;
+	}
+
+	void unlock()
+	{
+		SDL_UnlockSurface(screen);
+	}
+
+	/* Whether a screen co-ordinate lands on the screen once it's rounded down to a whole pixel (-0.5 rounds to 0). */
+	bool onScreen(float X, float Y)
+	{
+		return X > -1.0f && X < screenWidth && Y > -1.0f && Y < screenHeight;
+	}
+
+	/* Records a line in screen pixels, cutting off any parts that aren't on the screen. */
+	void addLine(float X0, float Y0, float X1, float Y1, unsigned long Colour)
+	{
+		if (!onScreen(X0, Y0) || !onScreen(X1, Y1))
+		{
+			if (!Clipping::Line(X0, Y0, X1, Y1, 0.0f, 0.0f, (float)(screenWidth - 1), (float)(screenHeight - 1)))
+				return;
+		}
+
+		int x0 = (int)X0;
+		int y0 = (int)Y0;
+		int x1 = (int)X1;
+		int y1 = (int)Y1;
+
+		/* The Bresenham loop can overshoot the end point by a pixel, so pad the area a little. */
+		drawn.Add((x0 < x1 ? x0 : x1) - 1, (y0 < y1 ? y0 : y1) - 1, (x0 > x1 ? x0 : x1) + 2, (y0 > y1 ? y0 : y1) + 2);
+		commands.AddLine(x0, y0, x1, y1, Colour);
+	}
+
+	/* Records a circle in screen pixels. Ones that hang over the edge of the screen are marked for clipping, and ones
+	   that are completely off it are skipped. */
+	void addCircle(float X, float Y, float Radius, unsigned long Colour)
+	{
+		if (!Clipping::Overlaps(X - Radius - 1.0f, Y - Radius - 1.0f, X + Radius + 1.0f, Y + Radius + 1.0f, 0.0f, 0.0f, (float)screenWidth, (float)screenHeight))
+			return;
+
+		int  cx      = (int)X;
+		int  cy      = (int)Y;
+		bool clipped = cx - Radius < 0 || cx + Radius >= screenWidth || cy - Radius < 0 || cy + Radius >= screenHeight;
+
+		drawn.Add((int)(cx - Radius) - 1, (int)(cy - Radius) - 1, (int)(cx + Radius) + 2, (int)(cy + Radius) + 2);
+		commands.AddCircle(cx, cy, Radius, Colour, clipped);
+	}
+
+	/* Converts a batch of world co-ordinates to screen pixels, see SimdTransform. */
+	void toScreen(const float *X, const float *Y, int Count, float *ScreenX, float *ScreenY)
+	{
+		SimdTransform::ToScreen(X, Y, Count, scale, (float)halfWidth, offsetX, (float)halfHeight, offsetY, (float)screenHeight, ScreenX, ScreenY);
+	}
+
+	static SDL_Rect toSDL(const DirtyRects::Rect &Rect)
+	{
+		SDL_Rect result;
+		result.x = (Sint16)Rect.Left;
+		result.y = (Sint16)Rect.Top;
+		result.w = (Uint16)(Rect.Right - Rect.Left);
+		result.h = (Uint16)(Rect.Bottom - Rect.Top);
+		return result;
+	}
+
+public:
+	RendererSDL()
+	{
+		screen     = NULL;
+		threadPool = NULL;
+	}
+
+	~RendererSDL()
+	{
+		Destroy();
+	}
+
+	bool Create(int Width, int Height, int FrameRate)
+	{
+		if (SDL_Init(SDL_INIT_VIDEO) < 0)
+			return Destroy("Could not initialise SDL.");
+
+		if ((screen = SDL_SetVideoMode(Width, Height, BPP, 0)) == NULL)
+			return Destroy("Error setting video mode");
+
+		screenWidth  = Width;
+		screenHeight = Height;
+		frameRate    = FrameRate;
+		halfWidth    = Width / 2;
+		halfHeight   = Height / 2;
+		scale        = 10.0f;
+		offsetX      = 0.0f;
+		offsetY      = 0.0f;
+
+		/* Pretend everything was drawn last frame, so that the first frame clears and presents the whole screen. */
+		drawn.SetBounds(Width, Height);
+		previous.SetBounds(Width, Height);
+		previous.All();
+		drawn.Clear();
+		return true;
+	}
+
+	bool Destroy(const char *Message = NULL)
+	{
+		if (Message != NULL)
+			printf("Message");
+
+		screen = NULL;
+		return false;
+	}
+
+	/* Lets FrameEnd() spread drawing over the Pool's threads, or back to drawing on the calling thread with NULL. */
+	void SetThreadPool(ThreadPool *Pool)
+	{
+		threadPool = Pool;
+	}
+
+	int FrameRate()
+	{
+		return frameRate;
+	}
+
+	/* This "moves the contents of the game around" on the screen. */
+	void SetTransform(float OffsetX, float OffsetY, float Scale)
+	{
+		offsetX = OffsetX;
+		offsetY = OffsetY;
+		scale   = Scale;
+	}
+
+	/* This converts a screen co-ordinate to an in-game co-ordinate. */
+	void ToWorld(float &X, float &Y)
+	{
+		X -= halfWidth;
+		X -= offsetX;
+		X /= scale;
+
+		Y  = screenHeight - Y;
+		Y -= halfHeight;
+		Y -= offsetY;
+		Y /= scale;
+	}
+
+	/* The area of the world that is on screen, for callers to skip things that wouldn't be seen. */
+	void GetView(float &Left, float &Bottom, float &Right, float &Top)
+	{
+		Left   = 0.0f;
+		Top    = 0.0f;
+		Right  = (float)screenWidth;
+		Bottom = (float)screenHeight;
+		ToWorld(Left, Top);
+		ToWorld(Right, Bottom);
+	}
+
+	/* This is called at the start of every single game frame.
+	   Use the time to clear the screen, reset view transformations, whatever here. */
+	void FrameStart()
+	{
+		for (int index = 0; index < previous.Count(); index++)
+		{
+			SDL_Rect rect = toSDL(previous.Get(index));
+			SDL_FillRect(screen, &rect, 0);
+		}
+		drawn.Clear();
+		commands.Clear();
+	}
+
+	/* This is called at the end of every single game frame, once everything has been drawn.
+	   Use it to blit the double-buffer to the screen. */
+	void FrameEnd()
+	{
+		if (commands.Count() > 0)
+		{
+			commands.Sort(screenHeight);
+			PIXELBUFFER *buffer = lock();
+			tiles.Rasterize(commands, buffer, screen->pitch / sizeof(PIXELBUFFER), screenWidth, screenHeight, threadPool);
+			unlock();
+		}
+
+		/* Both what was cleared and what was drawn have changed on screen. */
+		DirtyRects changed = previous;
+		changed.Add(drawn);
+		for (int index = 0; index < changed.Count(); index++)
+			updates[index] = toSDL(changed.Get(index));
+		if (changed.Count() > 0)
+			SDL_UpdateRects(screen, changed.Count(), updates);
+
+		previous = drawn;
+	}
+
+	/* Records a line from X0,Y0 to X1,Y1 in the specified Colour, to be drawn at the end of the frame. */
+	void Line(float X0, float Y0, float X1, float Y1, unsigned long Colour)
+	{
+		addLine(SCREENX(X0), SCREENY(Y0), SCREENX(X1), SCREENY(Y1), Colour);
+	}
+
+	/* Records a circle around X,Y with the specified Radius in the specified Colour, to be drawn at the end of the frame. */
+	void Circle(float X, float Y, float Radius, unsigned long Colour)
+	{
+		addCircle(SCREENX(X), SCREENY(Y), Radius * scale, Colour);
+	}
+
+	/* The batch versions convert BatchSize primitives to screen pixels at a time, on the stack. */
+	void Lines(const float *X0, const float *Y0, const float *X1, const float *Y1, const unsigned long *Colour, int Count)
+	{
+		float x0[BatchSize], y0[BatchSize], x1[BatchSize], y1[BatchSize];
+		for (int start = 0; start < Count; start += BatchSize)
+		{
+			int count = Count - start < BatchSize ? Count - start : BatchSize;
+			toScreen(X0 + start, Y0 + start, count, x0, y0);
+			toScreen(X1 + start, Y1 + start, count, x1, y1);
+			for (int index = 0; index < count; index++)
+				addLine(x0[index], y0[index], x1[index], y1[index], Colour[start + index]);
+		}
+	}
+
+	void Boxes(const float *X, const float *Y, const float *Width, const float *Height, const float *Cosine, const float *Sine, unsigned long Colour, int Count)
+	{
+		float cornerX[4 * BatchSize], cornerY[4 * BatchSize];
+		float x[4 * BatchSize], y[4 * BatchSize];
+		for (int start = 0; start < Count; start += BatchSize)
+		{
+			int count = Count - start < BatchSize ? Count - start : BatchSize;
+			SimdTransform::BoxCorners(X + start, Y + start, Width + start, Height + start, Cosine + start, Sine + start, count, cornerX, cornerY);
+			toScreen(cornerX, cornerY, 4 * count, x, y);
+
+			/* Corner c of box i is at c * count + i, and the edges go from each corner to the next. */
+			for (int index = 0; index < count; index++)
+			{
+				for (int corner = 0; corner < 4; corner++)
+				{
+					int from = corner * count + index;
+					int to   = ((corner + 1) & 3) * count + index;
+					addLine(x[from], y[from], x[to], y[to], Colour);
+				}
+			}
+		}
+	}
+
+	void Circles(const float *X, const float *Y, float Radius, unsigned long Colour, int Count)
+	{
+		float x[BatchSize], y[BatchSize];
+		for (int start = 0; start < Count; start += BatchSize)
+		{
+			int count = Count - start < BatchSize ? Count - start : BatchSize;
+			toScreen(X + start, Y + start, count, x, y);
+			for (int index = 0; index < count; index++)
+				addCircle(x[index], y[index], Radius * scale, Colour);
+		}
+	}
+
+	void Text(int X, int Y, const char *String, unsigned long Colour)
+	{
+		if (screen == NULL || String == NULL)
+			return;
+
+		drawn.Add(X, Y, X + 6 * (int)strlen(String), Y + 7);
+		commands.AddText(X, Y, String, Colour);
+	}
+
+	/* The commands recorded so far this frame, e.g., for printing out what a frame is made of. */
+	DrawList& Commands()
+	{
+		return commands;
+	}
+};
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __SETTLE_CACHE_H_
+#define __SETTLE_CACHE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/* This remembers the state a handful of bridge designs came to rest in under their own weight (see Bridge::settle()),
+   so that simulating the same design again can start from there instead of sagging into place all over again.
+
+   Designs are told apart by a 64 bit key worked out with Hash() from whatever makes up the design. When full, the
+   oldest entry is thrown out for the new one, its State memory being reused. */
+class SettleCache
+{
+public:
+	enum
+	{
+		Size = 8, /* How many designs are remembered. */
+	};
+
+	struct Entry
+	{
+		uint64_t  Key;
+		bool      Stable;   /* False if the design couldn't hold itself up, in which case State is meaningless. */
+		int       Count;    /* How many floats of State are in use. */
+		int       Capacity;
+		float    *State;
+	};
+
+	/* The starting value to give Hash(). */
+	static const uint64_t Seed = 14695981039346656037ULL;
+
+	/* Mixes Size bytes of Data into Key (FNV-1a), returning the new key. */
+	static uint64_t Hash(const void *Data, int Size, uint64_t Key)
+	{
+		const unsigned char *data = (const unsigned char*)Data;
+		for (int index = 0; index < Size; index++)
+		{
+			Key ^= data[index];
+			Key *= 1099511628211ULL;
+		}
+		return Key;
+	}
+
+protected:
+	Entry entries[Size];
+	int   used;
+	int   next;     /* The entry Store() hands out once they're all used. */
+
+public:
+	SettleCache()
+	{
+		memset(entries, 0, sizeof(entries));
+		used = 0;
+		next = 0;
+	}
+
+	~SettleCache()
+	{
+		for (int index = 0; index < Size; index++)
+			delete [] entries[index].State;
+	}
+
+	/* Returns the entry for Key, or NULL if it isn't remembered. */
+	Entry* Find(uint64_t Key)
+	{
+		for (int index = 0; index < used; index++)
+		{
+			if (entries[index].Key == Key)
+				return &entries[index];
+		}
+		return NULL;
+	}
+
+	/* Returns an entry for Key with room for Count floats of State, for the caller to fill in. */
+	Entry* Store(uint64_t Key, int Count)
+	{
+		Entry *entry = Find(Key);
+		if (entry == NULL)
+		{
+			entry = &entries[used < Size ? used++ : next];
+			next  = (next + 1) % Size;
+		}
+
+		if (entry->Capacity < Count)
+		{
+			delete [] entry->State;
+			entry->State    = new float[Count];
+			entry->Capacity = Count;
+		}
+		entry->Key    = Key;
+		entry->Stable = false;
+		entry->Count  = Count;
+		return entry;
+	}
+
+	/* Forgets every design, keeping the memory. */
+	void Clear()
+	{
+		used = 0;
+		next = 0;
+	}
+};
+
+#endif
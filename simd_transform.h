@@ -0,0 +1,111 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __SIMD_TRANSFORM_H_
+#define __SIMD_TRANSFORM_H_
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_TRANSFORM_SSE2
+#include <emmintrin.h>
+#endif
+
+/* Batch versions of the sums renderers do for every primitive, working on whole arrays at a time, four values at
+   once where SSE2 is available (which is any x86-64 compiler), and one at a time otherwise.
+   The sums are done in exactly the same order as the one-at-a-time versions, so a batch draws the very same pixels
+   as drawing each primitive on its own would. */
+class SimdTransform
+{
+public:
+	/* Turns world co-ordinates into screen pixels: X * Scale + CentreX + OffsetX across, and
+	   Height - (Y * Scale + CentreY + OffsetY) down, i.e., what RendererSDL's SCREENX and SCREENY do.
+	   These are left as floats so that they can be clipped before being rounded down to whole pixels. */
+	static void ToScreen(const float *X, const float *Y, int Count, float Scale, float CentreX, float OffsetX, float CentreY, float OffsetY, float Height, float *ScreenX, float *ScreenY)
+	{
+		int index = 0;
+
+#ifdef SIMD_TRANSFORM_SSE2
+		__m128 scale   = _mm_set1_ps(Scale);
+		__m128 centreX = _mm_set1_ps(CentreX);
+		__m128 offsetX = _mm_set1_ps(OffsetX);
+		__m128 centreY = _mm_set1_ps(CentreY);
+		__m128 offsetY = _mm_set1_ps(OffsetY);
+		__m128 height  = _mm_set1_ps(Height);
+		for (; index + 4 <= Count; index += 4)
+		{
+			__m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(X + index), scale), centreX), offsetX);
+			__m128 y = _mm_sub_ps(height, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(Y + index), scale), centreY), offsetY));
+			_mm_storeu_ps(ScreenX + index, x);
+			_mm_storeu_ps(ScreenY + index, y);
+		}
+#endif
+
+		for (; index < Count; index++)
+		{
+			ScreenX[index] = X[index] * Scale + CentreX + OffsetX;
+			ScreenY[index] = Height - (Y[index] * Scale + CentreY + OffsetY);
+		}
+	}
+
+	/* Works out the corners of Count boxes the same way Renderer::Box() does. The corners of box i end up at
+	   Corner[i], Corner[Count + i], Corner[2 * Count + i] and Corner[3 * Count + i], going around the box, so that
+	   CornerX and CornerY must each have room for 4 * Count values. */
+	static void BoxCorners(const float *X, const float *Y, const float *Width, const float *Height, const float *Cosine, const float *Sine, int Count, float *CornerX, float *CornerY)
+	{
+		float *ulX = CornerX,             *ulY = CornerY;
+		float *urX = CornerX + Count,     *urY = CornerY + Count;
+		float *brX = CornerX + 2 * Count, *brY = CornerY + 2 * Count;
+		float *blX = CornerX + 3 * Count, *blY = CornerY + 3 * Count;
+		int    index = 0;
+
+#ifdef SIMD_TRANSFORM_SSE2
+		__m128 two = _mm_set1_ps(2.0f);
+		for (; index + 4 <= Count; index += 4)
+		{
+			__m128 x            = _mm_loadu_ps(X + index);
+			__m128 y            = _mm_loadu_ps(Y + index);
+			__m128 halfWidth    = _mm_div_ps(_mm_loadu_ps(Width + index), two);
+			__m128 halfHeight   = _mm_div_ps(_mm_loadu_ps(Height + index), two);
+			__m128 cosine       = _mm_loadu_ps(Cosine + index);
+			__m128 sine         = _mm_loadu_ps(Sine + index);
+			__m128 widthCosine  = _mm_mul_ps(halfWidth, cosine);
+			__m128 heightCosine = _mm_mul_ps(halfHeight, cosine);
+			__m128 widthSine    = _mm_mul_ps(halfWidth, sine);
+			__m128 heightSine   = _mm_mul_ps(halfHeight, sine);
+			_mm_storeu_ps(ulX + index, _mm_sub_ps(_mm_add_ps(x, widthCosine),  heightSine));
+			_mm_storeu_ps(ulY + index, _mm_add_ps(_mm_add_ps(y, heightCosine), widthSine));
+			_mm_storeu_ps(urX + index, _mm_sub_ps(_mm_sub_ps(x, widthCosine),  heightSine));
+			_mm_storeu_ps(urY + index, _mm_sub_ps(_mm_add_ps(y, heightCosine), widthSine));
+			_mm_storeu_ps(blX + index, _mm_add_ps(_mm_add_ps(x, widthCosine),  heightSine));
+			_mm_storeu_ps(blY + index, _mm_add_ps(_mm_sub_ps(y, heightCosine), widthSine));
+			_mm_storeu_ps(brX + index, _mm_add_ps(_mm_sub_ps(x, widthCosine),  heightSine));
+			_mm_storeu_ps(brY + index, _mm_sub_ps(_mm_sub_ps(y, heightCosine), widthSine));
+		}
+#endif
+
+		for (; index < Count; index++)
+		{
+			float widthCosine  = (Width[index] / 2.0f) * Cosine[index];
+			float heightCosine = (Height[index] / 2.0f) * Cosine[index];
+			float widthSine    = (Width[index] / 2.0f) * Sine[index];
+			float heightSine   = (Height[index] / 2.0f) * Sine[index];
+			ulX[index] = X[index] + widthCosine  - heightSine;
+			ulY[index] = Y[index] + heightCosine + widthSine;
+			urX[index] = X[index] - widthCosine  - heightSine;
+			urY[index] = Y[index] + heightCosine - widthSine;
+			blX[index] = X[index] + widthCosine  + heightSine;
+			blY[index] = Y[index] - heightCosine + widthSine;
+			brX[index] = X[index] - widthCosine  + heightSine;
+			brY[index] = Y[index] - heightCosine - widthSine;
+		}
+	}
+};
+
+#endif
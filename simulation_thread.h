@@ -0,0 +1,224 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __SIMULATION_THREAD_H_
+#define __SIMULATION_THREAD_H_
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "bridge.h"
+#include "timer.h"
+
+typedef enum SimulationCommand_Type
+{
+	SimulationCommand_Touch = 0, /* Bridge::HandleTouch() at X,Y. */
+	SimulationCommand_Remove,    /* Bridge::RemoveAt() at X,Y. */
+	SimulationCommand_EditMode,  /* Bridge::SetEditMode() to Value. */
+	SimulationCommand_Start,
+	SimulationCommand_Stop,
+	SimulationCommand_SwapEngine,
+	SimulationCommand_Reset,     /* Bridge::Create(). */
+	SimulationCommand_TestBridge,
+}
+SimulationCommand_Type;
+
+/* Something the game wants done to the bridge, see SimulationThread::Push(). */
+struct SimulationCommand
+{
+	SimulationCommand_Type Type;
+	float                  X;
+	float                  Y;
+	int                    Value;
+};
+
+/* This runs the physics of a bridge on a thread of its own, so that a slow step (say, a big bridge coming down)
+   doesn't hold up input and drawing, and a slow frame doesn't hold up the physics.
+
+   Once Create() is called, the thread owns the Bridge: it runs fixed steps of Bridge::Simulate() to keep up with
+   the Timer, the same way the game loop used to, and nothing else may touch the bridge until Destroy().
+   Instead, the game Push()es commands, which are carried out before the next step, and draws Latest(), the most
+   recent BridgeSnapshot the thread has published.
+
+   Neither side ever waits for the other:
+   - Commands go through a ring that only the game writes to and only the simulation reads from, so each side
+     only has to publish where it is up to.
+   - Snapshots are triple buffered. The simulation fills in its back buffer and swaps it with the middle one, and
+     Latest() swaps the front buffer with the middle one if that has been filled in since, so there is always a
+     finished snapshot to draw and a free one to fill. */
+class SimulationThread
+{
+protected:
+	enum
+	{
+		Queue_Size = 256,    /* How many commands can be waiting at once. */
+		Fresh      = 1 << 2, /* Set on middle when the buffer it names hasn't been drawn yet. */
+	};
+
+	Bridge                 *bridge;
+	const Timer            *timer;
+	int                     stepRate;
+	int                     maxSteps;
+	std::thread             thread;
+	std::atomic<bool>       quit;
+
+	SimulationCommand       commands[Queue_Size];
+	std::atomic<int>        head;     /* The next command to carry out, only moved by the simulation... */
+	std::atomic<int>        tail;     /* ... and where the next one goes, only moved by the game. */
+
+	BridgeSnapshot          snapshots[3];
+	int                     back;     /* Only used by the simulation. */
+	int                     front;    /* Only used by the game. */
+	std::atomic<int>        middle;
+
+	void apply(const SimulationCommand &Command)
+	{
+		switch (Command.Type)
+		{
+			case SimulationCommand_Touch:      bridge->HandleTouch(Command.X, Command.Y); break;
+			case SimulationCommand_Remove:     bridge->RemoveAt(Command.X, Command.Y); break;
+			case SimulationCommand_EditMode:   bridge->SetEditMode((Bridge_EditMode)Command.Value); break;
+			case SimulationCommand_Start:      bridge->Start(); break;
+			case SimulationCommand_Stop:       bridge->Stop(); break;
+			case SimulationCommand_SwapEngine: bridge->SetEngine(bridge->Engine() == Bridge_Engine_Box2D ? Bridge_Engine_Truss : Bridge_Engine_Box2D); break;
+			case SimulationCommand_Reset:      bridge->Create(); break;
+			case SimulationCommand_TestBridge: bridge->CreateTestBridge(); break;
+		}
+	}
+
+	/* Publishes the bridge as it is now, Time being when its Current state is due. */
+	void publish(double Time)
+	{
+		bridge->Publish(snapshots[back]);
+		snapshots[back].Time = Time;
+		back = middle.exchange(back | Fresh) & ~Fresh;
+	}
+
+	/* The thread itself: carries out any commands, runs as many fixed size steps as are needed to catch up with
+	   the timer (letting time slip if that's more than maxSteps), publishes, then sleeps until the next step is due. */
+	void run()
+	{
+		const double stepTime    = 1.0 / stepRate;
+		double       lastTime    = timer->Seconds();
+		double       accumulator = 0.0;
+		bool         changed     = true;
+
+		while (!quit.load())
+		{
+			int next = head.load(std::memory_order_relaxed);
+			while (next != tail.load(std::memory_order_acquire))
+			{
+				apply(commands[next]);
+				next = (next + 1) % Queue_Size;
+				head.store(next, std::memory_order_release);
+				changed = true;
+			}
+
+			double now = timer->Seconds();
+			accumulator += now - lastTime;
+			lastTime     = now;
+
+			int steps = 0;
+			while (accumulator >= stepTime)
+			{
+				if (steps == maxSteps)
+				{
+					accumulator = 0.0;
+					break;
+				}
+				bridge->Simulate((float)stepTime);
+				accumulator -= stepTime;
+				steps++;
+			}
+
+			if (steps > 0 || changed)
+			{
+				publish(now - accumulator);
+				changed = false;
+			}
+
+			double remaining = stepTime - accumulator - (timer->Seconds() - now);
+			if (remaining > 0.0)
+				std::this_thread::sleep_for(std::chrono::duration<double>(remaining));
+		}
+	}
+
+public:
+	SimulationThread()
+	{
+		bridge   = NULL;
+		timer    = NULL;
+		stepRate = 60;
+		maxSteps = 15;
+		quit     = false;
+		head     = 0;
+		tail     = 0;
+		back     = 0;
+		middle   = 1;
+		front    = 2;
+	}
+
+	~SimulationThread()
+	{
+		Destroy();
+	}
+
+	/* Starts simulating Bridge at StepRate steps per second of Timer, running no more than MaxSteps steps at a time. */
+	bool Create(Bridge *Bridge, const Timer *Timer, int StepRate, int MaxSteps)
+	{
+		Destroy();
+		bridge   = Bridge;
+		timer    = Timer;
+		stepRate = StepRate;
+		maxSteps = MaxSteps;
+		quit     = false;
+		thread   = std::thread(&SimulationThread::run, this);
+		return true;
+	}
+
+	/* Stops the thread, after which the bridge belongs to the caller again. Commands not yet carried out are dropped. */
+	bool Destroy()
+	{
+		if (!thread.joinable())
+			return false;
+
+		quit = true;
+		thread.join();
+		head = tail.load();
+		return false;
+	}
+
+	/* Queues a command for the simulation, returning false if the queue is full. */
+	bool Push(SimulationCommand_Type Type, float X = 0.0f, float Y = 0.0f, int Value = 0)
+	{
+		int end  = tail.load(std::memory_order_relaxed);
+		int next = (end + 1) % Queue_Size;
+		if (next == head.load(std::memory_order_acquire))
+			return false;
+
+		commands[end].Type  = Type;
+		commands[end].X     = X;
+		commands[end].Y     = Y;
+		commands[end].Value = Value;
+		tail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	/* Returns the most recently published snapshot. It's the game's to draw (and Draw() blends it) until the next call. */
+	BridgeSnapshot& Latest()
+	{
+		if (middle.load() & Fresh)
+			front = middle.exchange(front) & ~Fresh;
+		return snapshots[front];
+	}
+};
+
+#endif
@@ -28,27 +28,30 @@ Slab_Purpose;
 class Slab
 {
 public:
-	Slab         *Next;         /* The next slab in the linked-list. */
 	Slab_Purpose  Purpose;      /* The purpose/material of this slab in the bridge, gets set by derived class constructors. */
 	Pin          *Left;         /* The first pin this slab is connected to, for simplicity sake, the "left" pin. */
 	Pin          *Right;        /* The second pin, referred to as the "right" pin. */
 	Positioning   Transform;    /* Describes the position and rotation of this slab, both at rest, and the current state. */
 	void         *PhysicBody;   /* Points to the object instance within the Physics world instance. */
 	float         Length;       /* The length of the slab, we need this for rendering. */
+	float         Stress;       /* The force on the slab during the last simulation step, as a fraction of the breaking force. */
+	int           NextLeft;     /* The index of the next slab attached to the Left pin, or -1, so that each pin has a */
+	int           NextRight;    /* list of its slabs starting at Pin::FirstSlab. Likewise for the Right pin. */
 
 protected:
-	void initialise(Pin *Left, Pin *Right, void *Body)
+	void initialise(TransformStore *Store, Pin *Left, Pin *Right, void *Body)
 	{
 		this->Left  = Left;
 		this->Right = Right;
 		PhysicBody  = Body;
+		Stress      = 0.0f;
 		if (Left != NULL && Right != NULL)
 		{
 			float differenceX = Right->Transform.X() - Left->Transform.X();
 			float differenceY = Right->Transform.Y() - Left->Transform.Y();
 			float angle       = atan2(differenceY, differenceX);
 			Length            = sqrt( (differenceX * differenceX) + (differenceY * differenceY) );
-			Transform.Initialise(Left->Transform.X() + differenceX / 2.0f, Left->Transform.Y() + differenceY / 2.0f, angle);
+			Transform.Initialise(Store, Left->Transform.X() + differenceX / 2.0f, Left->Transform.Y() + differenceY / 2.0f, angle);
 		}
 	}
 
@@ -58,16 +61,18 @@ protected:
 	}
 
 public:
-	Slab(Pin *Left, Pin *Right)
+	/* Store is where the bridge keeps the transforms of all its pins and slabs. */
+	Slab(TransformStore *Store, Pin *Left, Pin *Right)
 	{
-		Next    = NULL;
-		Purpose = Slab_Purpose_Invalid;
-		initialise(Left, Right, NULL);
+		Purpose   = Slab_Purpose_Invalid;
+		NextLeft  = -1;
+		NextRight = -1;
+		initialise(Store, Left, Right, NULL);
 	}
 
 	void Recalculate()
 	{
-		initialise(Left, Right, PhysicBody);
+		initialise(Transform.Store(), Left, Right, PhysicBody);
 	}
 };
 
@@ -24,7 +24,7 @@ protected:
 	}
 
 public:
-	SlabStructure(Pin *Left, Pin *Right) : Slab(Left, Right)
+	SlabStructure(TransformStore *Store, Pin *Left, Pin *Right) : Slab(Store, Left, Right)
 	{
 		Purpose = Slab_Purpose_Structure;
 	}
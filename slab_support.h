@@ -24,7 +24,7 @@ protected:
 	}
 
 public:
-	SlabSupport(Pin *Left, Pin *Right) : Slab(Left, Right)
+	SlabSupport(TransformStore *Store, Pin *Left, Pin *Right) : Slab(Store, Left, Right)
 	{
 		Purpose = Slab_Purpose_Support;
 	}
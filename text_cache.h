@@ -0,0 +1,211 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __TEXT_CACHE_H_
+#define __TEXT_CACHE_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "font_small.h"
+
+/* SmallFont stores its glyphs a column at a time, which is the wrong way around for drawing into a buffer a row at a
+   time. This turns the whole font around once, so that bit X of Rows[glyph][Y] says whether pixel X,Y is set. */
+class GlyphAtlas
+{
+public:
+	enum
+	{
+		First   = 32, /* The first character SmallFont has a glyph for. */
+		Count   = sizeof(SmallFont) / sizeof(SmallFont[0]),
+		Width   = 5,
+		Height  = 7,
+		Advance = 6,  /* How far along each character moves the next one. */
+	};
+
+	unsigned char Rows[Count][Height];
+
+	GlyphAtlas()
+	{
+		memset(Rows, 0, sizeof(Rows));
+		for (int glyph = 0; glyph < Count; glyph++)
+		{
+			for (int x = 0; x < Width; x++)
+			{
+				for (int y = 0; y < Height; y++)
+				{
+					if ((SmallFont[glyph][x] & (1 << y)) != 0)
+						Rows[glyph][y] |= 1 << x;
+				}
+			}
+		}
+	}
+
+	/* Returns the rows of the glyph for Character, characters the font doesn't have come out blank. */
+	const unsigned char* Get(char Character) const
+	{
+		static const unsigned char blank[Height] = {0};
+		int glyph = (unsigned char)Character - First;
+		return glyph >= 0 && glyph < Count ? Rows[glyph] : blank;
+	}
+};
+
+/* HUD text is mostly the same handful of strings every frame, so rather than working out which pixels each one
+   covers every time it's drawn, this remembers the answer for the last MaxLayers different strings.
+   Each string is kept as a list of horizontal runs of set pixels (its "layer"), which are then simply filled in with
+   whatever colour the text is drawn in. A string's layer is only worked out again once it has dropped out of the
+   cache, i.e., after MaxLayers other strings have been drawn since it was last used. */
+class TextCache
+{
+public:
+	typedef uint32_t Pixel;
+
+	enum
+	{
+		MaxLayers = 32,
+	};
+
+	/* Pixels X..X+Length-1 of row Y, relative to the top-left of the text, are set. */
+	struct Run
+	{
+		short X;
+		short Y;
+		short Length;
+	};
+
+protected:
+	struct Layer
+	{
+		char         *String;
+		unsigned int  Hash;
+		Run          *Runs;
+		int           RunCount;
+		unsigned int  Used;    /* When this layer was last drawn, so that the stalest one is thrown out first. */
+	};
+
+	GlyphAtlas   atlas;
+	Layer        layers[MaxLayers];
+	int          count;
+	unsigned int clock;
+
+	static unsigned int hash(const char *String)
+	{
+		unsigned int result = 2166136261u; /* FNV-1a */
+		for (; *String != 0; String++)
+			result = (result ^ (unsigned char)*String) * 16777619u;
+		return result;
+	}
+
+	/* Walks each row of the string, turning every unbroken stretch of set pixels into a Run.
+	   The first pass only counts them so that the runs can go in a single allocation. */
+	int build(const char *String, int Length, Run *Runs)
+	{
+		int result = 0;
+		for (int y = 0; y < GlyphAtlas::Height; y++)
+		{
+			for (int index = 0; index < Length; index++)
+			{
+				unsigned int row   = atlas.Get(String[index])[y];
+				int          start = -1;
+				for (int x = 0; x <= GlyphAtlas::Width; x++)
+				{
+					bool set = x < GlyphAtlas::Width && (row & (1 << x)) != 0;
+					if (set && start < 0)
+						start = x;
+					else if (!set && start >= 0)
+					{
+						if (Runs != NULL)
+						{
+							Runs[result].X      = (short)(index * GlyphAtlas::Advance + start);
+							Runs[result].Y      = (short)y;
+							Runs[result].Length = (short)(x - start);
+						}
+						result++;
+						start = -1;
+					}
+				}
+			}
+		}
+		return result;
+	}
+
+	void release(Layer &Layer)
+	{
+		delete [] Layer.String;
+		delete [] Layer.Runs;
+	}
+
+	Layer& find(const char *String)
+	{
+		unsigned int key = hash(String);
+		for (int index = 0; index < count; index++)
+		{
+			if (layers[index].Hash == key && strcmp(layers[index].String, String) == 0)
+				return layers[index];
+		}
+
+		/* Not cached, so take a free slot, or throw out the layer that has gone unused the longest. */
+		int slot = count;
+		if (count < MaxLayers)
+			count++;
+		else
+		{
+			slot = 0;
+			for (int index = 1; index < count; index++)
+			{
+				if (clock - layers[index].Used > clock - layers[slot].Used)
+					slot = index;
+			}
+			release(layers[slot]);
+		}
+
+		int    length = (int)strlen(String);
+		Layer &layer  = layers[slot];
+		layer.String   = new char[length + 1];
+		memcpy(layer.String, String, length + 1);
+		layer.Hash     = key;
+		layer.RunCount = build(String, length, NULL);
+		layer.Runs     = new Run[layer.RunCount > 0 ? layer.RunCount : 1];
+		build(String, length, layer.Runs);
+		return layer;
+	}
+
+public:
+	TextCache()
+	{
+		count = 0;
+		clock = 0;
+	}
+
+	~TextCache()
+	{
+		for (int index = 0; index < count; index++)
+			release(layers[index]);
+	}
+
+	/* Draws String with its top-left corner at X,Y into Buffer, whose rows are Stride pixels apart.
+	   There is no clipping, the whole string must fit in the buffer. */
+	void Draw(Pixel *Buffer, int Stride, int X, int Y, const char *String, Pixel Colour)
+	{
+		Layer &layer = find(String);
+		layer.Used = ++clock;
+
+		Pixel *origin = Buffer + X + Y * Stride;
+		for (int index = 0; index < layer.RunCount; index++)
+		{
+			const Run &run   = layer.Runs[index];
+			Pixel     *pixel = origin + run.X + run.Y * Stride;
+			for (int x = 0; x < run.Length; x++)
+				pixel[x] = Colour;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __THREAD_POOL_H_
+#define __THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/* A handful of threads that sit waiting to split up a loop between them, so that we don't pay for starting
+   threads every time we want to do a bit of work in parallel.
+
+   Run() calls Task(Context, Begin, End) for consecutive ranges of Chunk items until all Count items are done, on the
+   pool's threads as well as the calling thread, and only returns once every range has finished.
+   Tasks must not call Run() on the same pool. */
+class ThreadPool
+{
+public:
+	typedef void (*Task)(void *Context, int Begin, int End);
+
+protected:
+	std::thread             *threads;
+	int                      threadCount;
+	std::mutex               lock;
+	std::condition_variable  wake;       /* Signalled when there is new work, or when it's time to quit. */
+	std::condition_variable  finished;   /* Signalled when the last busy thread is done with the current work. */
+	Task                     task;
+	void                    *context;
+	int                      count;
+	int                      chunk;
+	std::atomic<int>         next;       /* The first item not yet claimed by any thread. */
+	int                      busy;       /* How many pool threads haven't finished the current work yet. */
+	unsigned int             generation; /* Bumped for every Run(), so threads can tell new work from old. */
+	bool                     quit;
+
+	void runChunks()
+	{
+		int begin;
+		while ((begin = next.fetch_add(chunk)) < count)
+		{
+			int end = begin + chunk < count ? begin + chunk : count;
+			task(context, begin, end);
+		}
+	}
+
+	void work()
+	{
+		unsigned int seen = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				while (!quit && generation == seen)
+					wake.wait(guard);
+				if (quit)
+					return;
+				seen = generation;
+			}
+
+			runChunks();
+
+			std::lock_guard<std::mutex> guard(lock);
+			if (--busy == 0)
+				finished.notify_one();
+		}
+	}
+
+public:
+	/* Threads is the number of extra threads to start, the thread calling Run() always helps out as well. */
+	ThreadPool(int Threads)
+	{
+		threadCount = Threads > 0 ? Threads : 0;
+		task        = NULL;
+		context     = NULL;
+		count       = 0;
+		chunk       = 1;
+		next        = 0;
+		busy        = 0;
+		generation  = 0;
+		quit        = false;
+		threads     = new std::thread[threadCount];
+		for (int index = 0; index < threadCount; index++)
+			threads[index] = std::thread(&ThreadPool::work, this);
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			quit = true;
+		}
+		wake.notify_all();
+		for (int index = 0; index < threadCount; index++)
+			threads[index].join();
+		delete [] threads;
+	}
+
+	/* Returns how many threads work on a Run(), including the calling one. */
+	int Threads()
+	{
+		return threadCount + 1;
+	}
+
+	void Run(Task Task, void *Context, int Count, int Chunk)
+	{
+		if (Count <= 0)
+			return;
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			task    = Task;
+			context = Context;
+			count   = Count;
+			chunk   = Chunk > 0 ? Chunk : 1;
+			next    = 0;
+			busy    = threadCount;
+			generation++;
+		}
+		wake.notify_all();
+
+		runChunks();
+
+		std::unique_lock<std::mutex> guard(lock);
+		while (busy > 0)
+			finished.wait(guard);
+	}
+};
+
+#endif
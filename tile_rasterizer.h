@@ -0,0 +1,179 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __TILE_RASTERIZER_H_
+#define __TILE_RASTERIZER_H_
+
+#include <string.h>
+#include "draw_list.h"
+#include "thread_pool.h"
+
+/* This draws a DrawList with the help of a ThreadPool, by cutting the buffer up into square tiles and giving each
+   thread whole tiles to draw.
+   First every line and circle is put into the bin of each tile its bounds touch, then the tiles are drawn in
+   parallel, each only drawing its own pixels of the commands in its bin. As the bins keep the commands in the order
+   of the list, every pixel ends up exactly as if the list had been drawn in one go.
+   Text goes through the (single threaded) TextCache, so it is drawn afterwards on the calling thread. DrawList::Sort()
+   puts it last anyway, so the HUD still ends up on top. */
+class TileRasterizer
+{
+public:
+	typedef DrawList::Pixel Pixel;
+
+	enum
+	{
+		TileSize    = 64,  /* The width and height of a tile in pixels. */
+		MinCommands = 256, /* With fewer commands than this, binning costs more than it saves, so the list is drawn in one go. */
+	};
+
+protected:
+	DrawList    *list;
+	Pixel       *buffer;
+	int          stride;
+	int          width;
+	int          height;
+	int          tilesAcross;
+	int          tilesDown;
+	int         *binStart;   /* Where each tile's bin starts in binItems, with one extra entry for the end of the last. */
+	int         *binItems;   /* The indices of the commands in each bin, one bin after the other. */
+	int          tileCapacity;
+	int          itemCapacity;
+
+	/* Works out which tiles a command touches, returning false if it lands on none of them. */
+	bool tiles(const DrawCommand &Command, int &Left, int &Top, int &Right, int &Bottom)
+	{
+		DrawArea area;
+		DrawList::Bounds(Command, area);
+		if (area.Right <= 0 || area.Bottom <= 0 || area.Left >= width || area.Top >= height)
+			return false;
+
+		Left   = area.Left > 0 ? area.Left / TileSize : 0;
+		Top    = area.Top  > 0 ? area.Top  / TileSize : 0;
+		Right  = (area.Right  - 1) / TileSize;
+		Bottom = (area.Bottom - 1) / TileSize;
+		if (Right >= tilesAcross)
+			Right = tilesAcross - 1;
+		if (Bottom >= tilesDown)
+			Bottom = tilesDown - 1;
+		return true;
+	}
+
+	/* Fills the bins with a counting sort, much like DrawList::Sort(): count, turn counts into starts, then scatter. */
+	void bin()
+	{
+		int tileCount = tilesAcross * tilesDown;
+		if (tileCount + 1 > tileCapacity)
+		{
+			delete [] binStart;
+			tileCapacity = tileCount + 1;
+			binStart     = new int[tileCapacity];
+		}
+		memset(binStart, 0, sizeof(int) * (tileCount + 1));
+
+		int left, top, right, bottom, items = 0;
+		for (int index = 0; index < list->Count(); index++)
+		{
+			const DrawCommand &command = list->Get(index);
+			if (command.Type == DrawCommand_Text || !tiles(command, left, top, right, bottom))
+				continue;
+			for (int y = top; y <= bottom; y++)
+				for (int x = left; x <= right; x++)
+					binStart[y * tilesAcross + x + 1]++;
+			items += (right - left + 1) * (bottom - top + 1);
+		}
+		for (int tile = 1; tile <= tileCount; tile++)
+			binStart[tile] += binStart[tile - 1];
+
+		if (items > itemCapacity)
+		{
+			delete [] binItems;
+			itemCapacity = items * 2;
+			binItems     = new int[itemCapacity];
+		}
+
+		/* Scatter using binStart as the running position of each bin, which leaves each entry at the start of the
+		   next bin, so shift everything back down a place afterwards. */
+		for (int index = 0; index < list->Count(); index++)
+		{
+			const DrawCommand &command = list->Get(index);
+			if (command.Type == DrawCommand_Text || !tiles(command, left, top, right, bottom))
+				continue;
+			for (int y = top; y <= bottom; y++)
+				for (int x = left; x <= right; x++)
+					binItems[binStart[y * tilesAcross + x]++] = index;
+		}
+		memmove(binStart + 1, binStart, sizeof(int) * tileCount);
+		binStart[0] = 0;
+	}
+
+	static void drawTiles(void *Context, int Begin, int End)
+	{
+		TileRasterizer *self = (TileRasterizer*)Context;
+		for (int tile = Begin; tile < End; tile++)
+		{
+			DrawArea clip;
+			clip.Left   = (tile % self->tilesAcross) * TileSize;
+			clip.Top    = (tile / self->tilesAcross) * TileSize;
+			clip.Right  = clip.Left + TileSize < self->width  ? clip.Left + TileSize : self->width;
+			clip.Bottom = clip.Top  + TileSize < self->height ? clip.Top  + TileSize : self->height;
+
+			for (int item = self->binStart[tile]; item < self->binStart[tile + 1]; item++)
+				DrawList::RasterizeShape(self->buffer, self->stride, clip, self->list->Get(self->binItems[item]));
+		}
+	}
+
+public:
+	TileRasterizer()
+	{
+		list         = NULL;
+		buffer       = NULL;
+		binStart     = NULL;
+		binItems     = NULL;
+		tileCapacity = 0;
+		itemCapacity = 0;
+	}
+
+	~TileRasterizer()
+	{
+		delete [] binStart;
+		delete [] binItems;
+	}
+
+	/* Draws List into Buffer (Width by Height pixels, rows Stride pixels apart), spread over the Pool's threads.
+	   Without a Pool, or with very few commands, this is the same as List.Rasterize(). */
+	void Rasterize(DrawList &List, Pixel *Buffer, int Stride, int Width, int Height, ThreadPool *Pool)
+	{
+		if (Pool == NULL || Pool->Threads() < 2 || List.Count() < MinCommands)
+		{
+			List.Rasterize(Buffer, Stride, Width, Height);
+			return;
+		}
+
+		list        = &List;
+		buffer      = Buffer;
+		stride      = Stride;
+		width       = Width;
+		height      = Height;
+		tilesAcross = (Width  + TileSize - 1) / TileSize;
+		tilesDown   = (Height + TileSize - 1) / TileSize;
+
+		bin();
+		Pool->Run(drawTiles, this, tilesAcross * tilesDown, 1);
+
+		for (int index = 0; index < List.Count(); index++)
+		{
+			if (List.Get(index).Type == DrawCommand_Text)
+				List.RasterizeText(Buffer, Stride, List.Get(index));
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __TIMER_H_
+#define __TIMER_H_
+
+#include <chrono>
+
+/* A simple high resolution stopwatch, counting seconds since it was last Reset().
+   SDL_GetTicks() only has millisecond accuracy, which isn't good enough to feed a fixed timestep accumulator,
+   so this uses the monotonic clock from the standard library instead. */
+class Timer
+{
+protected:
+	typedef std::chrono::steady_clock Clock;
+
+protected:
+	Clock::time_point start;
+
+public:
+	Timer()
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		start = Clock::now();
+	}
+
+	/* Returns the number of seconds that have passed since the last call to Reset(). */
+	double Seconds() const
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+};
+
+#endif
@@ -0,0 +1,250 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __TRANSFORM_STORE_H_
+#define __TRANSFORM_STORE_H_
+
+#include <math.h>
+#include <string.h>
+
+/* This holds the position and rotation of every pin and slab in a bridge, as separate arrays of x, y, cosine and sine
+   rather than one little structure per object. Each object owns one index into all of the arrays (see Positioning).
+
+   There are four sets of arrays:
+     Original - the edit-time values.
+     Current  - what the physics engine last said.
+     Previous - what the physics engine said the step before, used to blend between steps when drawing.
+     Drawn    - the blend of Previous and Current worked out by Interpolate(), which is what drawing code reads.
+
+   Everything that touches all objects at once (copying the state from the physics engine, resetting back to
+   edit time, blending for drawing) is then a straight walk, or a single memcpy, over a handful of arrays. */
+class TransformStore
+{
+public:
+	enum
+	{
+		Original = 0,
+		Current,
+		Previous,
+		Drawn,
+		Sets,
+	};
+
+	/* One set of transform arrays. */
+	struct Set
+	{
+		float *X;
+		float *Y;
+		float *Cosine;
+		float *Sine;
+	};
+
+protected:
+	Set     sets[Sets];
+	void  **bodies;   /* The physics engine body each index follows, or NULL if it isn't driven by a body. */
+	int    *released; /* Indices given back by Release(), which Add() hands out again before making new ones. */
+	int     releasedCount;
+	int     count;
+	int     capacity;
+
+	static float* grow(float *Array, int Count, int Capacity)
+	{
+		float *result = new float[Capacity];
+		if (Count > 0)
+			memcpy(result, Array, sizeof(float) * Count);
+		delete [] Array;
+		return result;
+	}
+
+	void copy(int To, int From)
+	{
+		if (count == 0)
+			return;
+
+		memcpy(sets[To].X,      sets[From].X,      sizeof(float) * count);
+		memcpy(sets[To].Y,      sets[From].Y,      sizeof(float) * count);
+		memcpy(sets[To].Cosine, sets[From].Cosine, sizeof(float) * count);
+		memcpy(sets[To].Sine,   sets[From].Sine,   sizeof(float) * count);
+	}
+
+	/* Makes room for Capacity entries, keeping the ones there are. */
+	void reserve(int Capacity)
+	{
+		if (Capacity <= capacity)
+			return;
+
+		for (int set = 0; set < Sets; set++)
+		{
+			sets[set].X      = grow(sets[set].X,      count, Capacity);
+			sets[set].Y      = grow(sets[set].Y,      count, Capacity);
+			sets[set].Cosine = grow(sets[set].Cosine, count, Capacity);
+			sets[set].Sine   = grow(sets[set].Sine,   count, Capacity);
+		}
+
+		void **grownBodies = new void*[Capacity];
+		if (count > 0)
+			memcpy(grownBodies, bodies, sizeof(void*) * count);
+		delete [] bodies;
+		delete [] released; /* Never holds anything here, as Add() empties it before growing. */
+		bodies   = grownBodies;
+		released = new int[Capacity];
+		capacity = Capacity;
+	}
+
+public:
+	TransformStore()
+	{
+		memset(sets, 0, sizeof(sets));
+		bodies        = NULL;
+		released      = NULL;
+		releasedCount = 0;
+		count         = 0;
+		capacity      = 0;
+	}
+
+	~TransformStore()
+	{
+		for (int set = 0; set < Sets; set++)
+		{
+			delete [] sets[set].X;
+			delete [] sets[set].Y;
+			delete [] sets[set].Cosine;
+			delete [] sets[set].Sine;
+		}
+		delete [] bodies;
+		delete [] released;
+	}
+
+	/* Adds a new entry at the edit-time position and angle given, returning its index. */
+	int Add(float X, float Y, float Angle)
+	{
+		if (releasedCount > 0)
+		{
+			int index = released[--releasedCount];
+			bodies[index] = NULL;
+			Initialise(index, X, Y, Angle);
+			return index;
+		}
+
+		if (count == capacity)
+			reserve(capacity > 0 ? capacity * 2 : 256);
+
+		bodies[count] = NULL;
+		Initialise(count, X, Y, Angle);
+		return count++;
+	}
+
+	/* Sets new edit-time values for an existing entry, and resets it to them. */
+	void Initialise(int Index, float X, float Y, float Angle)
+	{
+		float cosine = cos(Angle);
+		float sine   = sin(Angle);
+		for (int set = 0; set < Sets; set++)
+		{
+			sets[set].X[Index]      = X;
+			sets[set].Y[Index]      = Y;
+			sets[set].Cosine[Index] = cosine;
+			sets[set].Sine[Index]   = sine;
+		}
+	}
+
+	/* Gives an entry back once whatever owned it is gone. It keeps its place in the arrays (so no other index moves),
+	   it's just no longer followed by a body, and will be handed out again by the next Add(). */
+	void Release(int Index)
+	{
+		bodies[Index]             = NULL;
+		released[releasedCount++] = Index;
+	}
+
+	/* Makes this store hold the same Previous and Current sets as Source, e.g., so that another thread can draw them
+	   while Source carries on being simulated. The other sets and the bodies aren't copied. */
+	void CopyFrom(TransformStore &Source)
+	{
+		releasedCount = 0;
+		reserve(Source.count);
+		count         = Source.count;
+		if (count == 0)
+			return;
+
+		const int copied[2] = { Previous, Current };
+		for (int which = 0; which < 2; which++)
+		{
+			Set &to   = sets[copied[which]];
+			Set &from = Source.sets[copied[which]];
+			memcpy(to.X,      from.X,      sizeof(float) * count);
+			memcpy(to.Y,      from.Y,      sizeof(float) * count);
+			memcpy(to.Cosine, from.Cosine, sizeof(float) * count);
+			memcpy(to.Sine,   from.Sine,   sizeof(float) * count);
+		}
+	}
+
+	/* Forgets all entries, keeping the memory for reuse. */
+	void Clear()
+	{
+		count         = 0;
+		releasedCount = 0;
+	}
+
+	/* Puts everything back to its edit-time values, and forgets the physics bodies (the world they were in is gone). */
+	void Reset()
+	{
+		copy(Current,  Original);
+		copy(Previous, Original);
+		copy(Drawn,    Original);
+		if (count > 0)
+			memset(bodies, 0, sizeof(void*) * count);
+	}
+
+	/* Call this just before the physics engine writes a new Current state, so that Previous holds the old one. */
+	void BeginStep()
+	{
+		copy(Previous, Current);
+	}
+
+	/* This works out the Drawn set, Alpha of the way from Previous to Current. The rotation is blended as a
+	   vector and renormalised, so that boxes don't shrink when spinning quickly. */
+	void Interpolate(float Alpha)
+	{
+		const float *previousX = sets[Previous].X, *previousY = sets[Previous].Y, *previousC = sets[Previous].Cosine, *previousS = sets[Previous].Sine;
+		const float *currentX  = sets[Current].X,  *currentY  = sets[Current].Y,  *currentC  = sets[Current].Cosine,  *currentS  = sets[Current].Sine;
+		float       *drawnX    = sets[Drawn].X,    *drawnY    = sets[Drawn].Y,    *drawnC    = sets[Drawn].Cosine,    *drawnS    = sets[Drawn].Sine;
+
+		for (int index = 0; index < count; index++)
+		{
+			float c      = previousC[index] + (currentC[index] - previousC[index]) * Alpha;
+			float s      = previousS[index] + (currentS[index] - previousS[index]) * Alpha;
+			float length = sqrtf(c * c + s * s);
+			float scale  = length > 0.0f ? 1.0f / length : 0.0f;
+
+			drawnX[index] = previousX[index] + (currentX[index] - previousX[index]) * Alpha;
+			drawnY[index] = previousY[index] + (currentY[index] - previousY[index]) * Alpha;
+			drawnC[index] = c * scale;
+			drawnS[index] = s * scale;
+		}
+	}
+
+	int Count()
+	{
+		return count;
+	}
+
+	Set& Get(int Which)
+	{
+		return sets[Which];
+	}
+
+	void** Bodies()
+	{
+		return bodies;
+	}
+};
+
+#endif
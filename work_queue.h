@@ -0,0 +1,89 @@
+/*
+ZLib license:
+Copyright (c) 2012 Dirk de la Hunt aka NoshBar @gmail.com
+
+This software is provided 'as-is', without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef __WORK_QUEUE_H_
+#define __WORK_QUEUE_H_
+
+#include <mutex>
+
+/* This hands out job numbers 0..Jobs-1 to a fixed number of workers.
+   Each worker starts with its own contiguous range of jobs that it takes from the front of. Once a worker runs out, it
+   steals jobs from the back of the other workers' ranges, so that a worker stuck on a few slow jobs doesn't hold up
+   the ones that happened to get quick jobs.
+   Each range has its own lock, so workers only ever contend with each other when stealing. */
+class WorkQueue
+{
+protected:
+	struct Range
+	{
+		std::mutex Lock;
+		int        Next; /* The next job the owner will take. */
+		int        End;  /* One past the last job in the range, thieves take End - 1. */
+	};
+
+protected:
+	Range *ranges;
+	int    rangeCount;
+
+	bool takeFront(Range &Range, int &Job)
+	{
+		std::lock_guard<std::mutex> guard(Range.Lock);
+		if (Range.Next >= Range.End)
+			return false;
+		Job = Range.Next++;
+		return true;
+	}
+
+	bool takeBack(Range &Range, int &Job)
+	{
+		std::lock_guard<std::mutex> guard(Range.Lock);
+		if (Range.Next >= Range.End)
+			return false;
+		Job = --Range.End;
+		return true;
+	}
+
+public:
+	WorkQueue(int Jobs, int Workers)
+	{
+		if (Workers < 1)
+			Workers = 1;
+
+		rangeCount = Workers;
+		ranges     = new Range[rangeCount];
+		for (int index = 0; index < rangeCount; index++)
+		{
+			ranges[index].Next = (int)(((long long)Jobs * index) / rangeCount);
+			ranges[index].End  = (int)(((long long)Jobs * (index + 1)) / rangeCount);
+		}
+	}
+
+	~WorkQueue()
+	{
+		delete [] ranges;
+	}
+
+	/* Fetches the next job for Worker, returning false once there is no work left anywhere. */
+	bool Pop(int Worker, int &Job)
+	{
+		if (takeFront(ranges[Worker], Job))
+			return true;
+
+		for (int offset = 1; offset < rangeCount; offset++)
+		{
+			if (takeBack(ranges[(Worker + offset) % rangeCount], Job))
+				return true;
+		}
+		return false;
+	}
+};
+
+#endif